@@ -0,0 +1,55 @@
+################################################################################
+# HEADLESS BUILD
+#   Builds the solver core (src/Data, src/Generation, src/Util and
+#   TileMapGenerator) as a static library without openFrameworks, and the
+#   command line tools linked against it.
+#
+#     make wfc_cli          builds bin/wfc_cli
+#     make wfc_bench        builds bin/wfc_bench, run it from the project root
+#     make clean_headless   removes the headless objects and tools
+#
+#   pugixml is located with pkg-config. Override PUGIXML_CFLAGS / PUGIXML_LIBS
+#   to use another copy, e.g. the one bundled with openFrameworks.
+################################################################################
+
+HEADLESS_CXX ?= $(CXX)
+HEADLESS_CXXFLAGS ?= -std=c++2b -O3 -DNDEBUG -Wall -Wextra
+HEADLESS_LDFLAGS ?= -pthread
+HEADLESS_OBJ_DIR = obj/headless
+
+PUGIXML_CFLAGS ?= $(shell pkg-config --cflags pugixml 2>/dev/null)
+PUGIXML_LIBS ?= $(shell pkg-config --libs pugixml 2>/dev/null || echo -lpugixml)
+
+# everything but the openFrameworks app and its rendering
+WFC_CORE_SOURCES = $(wildcard src/Data/*.cpp src/Generation/*.cpp src/Util/*.cpp) src/TileMapGenerator.cpp
+WFC_CORE_OBJECTS = $(WFC_CORE_SOURCES:%.cpp=$(HEADLESS_OBJ_DIR)/%.o)
+WFC_CORE_LIB = $(HEADLESS_OBJ_DIR)/libwfc_core.a
+
+WFC_CLI_OBJECTS = $(HEADLESS_OBJ_DIR)/tools/wfc_cli.o
+WFC_BENCH_OBJECTS = $(HEADLESS_OBJ_DIR)/tools/wfc_bench.o
+
+.PHONY: wfc_core wfc_cli wfc_bench clean_headless
+
+wfc_core: $(WFC_CORE_LIB)
+
+wfc_cli: bin/wfc_cli
+
+wfc_bench: bin/wfc_bench
+
+$(HEADLESS_OBJ_DIR)/%.o: %.cpp
+	@mkdir -p $(dir $@)
+	$(HEADLESS_CXX) $(HEADLESS_CXXFLAGS) -Isrc $(PUGIXML_CFLAGS) -MMD -MP -c $< -o $@
+
+$(WFC_CORE_LIB): $(WFC_CORE_OBJECTS)
+	$(AR) rcs $@ $^
+
+bin/wfc_cli: $(WFC_CLI_OBJECTS) $(WFC_CORE_LIB)
+	$(HEADLESS_CXX) $(HEADLESS_CXXFLAGS) $^ $(PUGIXML_LIBS) $(HEADLESS_LDFLAGS) -o $@
+
+bin/wfc_bench: $(WFC_BENCH_OBJECTS) $(WFC_CORE_LIB)
+	$(HEADLESS_CXX) $(HEADLESS_CXXFLAGS) $^ $(PUGIXML_LIBS) $(HEADLESS_LDFLAGS) -o $@
+
+clean_headless:
+	rm -rf $(HEADLESS_OBJ_DIR) bin/wfc_cli bin/wfc_bench
+
+-include $(WFC_CORE_OBJECTS:.o=.d) $(WFC_CLI_OBJECTS:.o=.d) $(WFC_BENCH_OBJECTS:.o=.d)
@@ -0,0 +1,46 @@
+#include "AdjacencyTable.h"
+
+#include "Domain.h"
+
+AdjacencyTable::AdjacencyTable(const int tile_count, const int number_of_sides)
+	: m_tile_count(tile_count), m_number_of_sides(number_of_sides), m_word_count(Domain::words_for(tile_count)),
+	m_mask_indices(tile_count * number_of_sides, 0), m_support_counts(tile_count * number_of_sides, 0)
+{
+	m_mask_index_data = m_mask_indices.data();
+	m_support_count_data = m_support_counts.data();
+}
+
+AdjacencyTable::AdjacencyTable(const int tile_count, const int number_of_sides, const int mask_count, const uint64_t* mask_words,
+	const int32_t* mask_indices, const int32_t* support_counts, std::shared_ptr<const void> storage)
+	: m_tile_count(tile_count), m_number_of_sides(number_of_sides), m_word_count(Domain::words_for(tile_count)),
+	m_mask_count(mask_count), m_mask_data(mask_words), m_mask_index_data(mask_indices), m_support_count_data(support_counts),
+	m_storage(std::move(storage))
+{
+}
+
+int AdjacencyTable::add_mask()
+{
+	const int mask_idx = m_mask_count++;
+	m_mask_words.resize(m_mask_words.size() + m_word_count, 0);
+	m_mask_data = m_mask_words.data();
+
+	return mask_idx;
+}
+
+void AdjacencyTable::finalize()
+{
+	for (int tile_id = 0; tile_id < m_tile_count; ++tile_id)
+	{
+		for (int side = 0; side < m_number_of_sides; ++side)
+		{
+			const uint64_t* mask = get_mask(tile_id, side);
+			int support = 0;
+			for (int i = 0; i < m_word_count; ++i)
+			{
+				support += std::popcount(mask[i]);
+			}
+
+			m_support_counts[tile_id * m_number_of_sides + side] = support;
+		}
+	}
+}
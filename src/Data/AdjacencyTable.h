@@ -0,0 +1,121 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @class AdjacencyTable
+ * @brief Compiled, read-only adjacency rules: one bitmask of compatible tile IDs per tile and side.
+ * Tiles that share an edge on a side share the same mask, all masks live in one contiguous buffer.
+ * The buffers are either owned, while compiling the table, or views into external storage such as a mapped TileSetCache.
+ */
+class AdjacencyTable
+{
+public:
+	static_assert(sizeof(int) == sizeof(int32_t), "cached tables store mask indices and support counts as int32_t");
+
+	AdjacencyTable(int tile_count, int number_of_sides);
+
+	/**
+	 * @brief Constructs a finalized table viewing already compiled buffers, without copying them
+	 * @param mask_words mask_count * word count words
+	 * @param mask_indices, support_counts tile_count * number_of_sides entries each
+	 * @param storage Kept alive as long as the table, owns the viewed buffers
+	 */
+	AdjacencyTable(int tile_count, int number_of_sides, int mask_count, const uint64_t* mask_words,
+		const int32_t* mask_indices, const int32_t* support_counts, std::shared_ptr<const void> storage);
+
+	// the views point into the table's own buffers
+	AdjacencyTable(const AdjacencyTable&) = delete;
+	AdjacencyTable& operator=(const AdjacencyTable&) = delete;
+
+	int get_tile_count() const { return m_tile_count; }
+	int get_number_of_sides() const { return m_number_of_sides; }
+
+	// Number of uint64_t words in each mask
+	int get_word_count() const { return m_word_count; }
+	int get_mask_count() const { return m_mask_count; }
+
+	// The raw buffers, e.g. to write them to a TileSetCache
+	const uint64_t* get_mask_data() const { return m_mask_data; }
+	const int32_t* get_mask_index_data() const { return m_mask_index_data; }
+	const int32_t* get_support_count_data() const { return m_support_count_data; }
+
+	/**
+	 * @brief Returns the mask of tile IDs allowed next to tile_id on the given side
+	 */
+	const uint64_t* get_mask(const int tile_id, const int side) const
+	{
+		return m_mask_data + static_cast<size_t>(m_mask_index_data[tile_id * m_number_of_sides + side]) * m_word_count;
+	}
+
+	// Index of the mask get_mask returns, tiles with the same index share the mask
+	int get_mask_index(const int tile_id, const int side) const { return m_mask_index_data[tile_id * m_number_of_sides + side]; }
+
+	/**
+	 * @brief Returns the number of tile IDs allowed next to tile_id on the given side
+	 */
+	int get_support_count(const int tile_id, const int side) const { return m_support_count_data[tile_id * m_number_of_sides + side]; }
+
+	bool is_allowed(const int tile_id, const int side, const int neighbor_tile_id) const
+	{
+		return (get_mask(tile_id, side)[neighbor_tile_id / 64] >> (neighbor_tile_id % 64)) & 1;
+	}
+
+	/**
+	 * @brief Calls func(neighbor_tile_id) for every tile ID allowed next to tile_id on the given side
+	 */
+	template <typename Func>
+	void for_each_allowed(const int tile_id, const int side, Func&& func) const
+	{
+		const uint64_t* mask = get_mask(tile_id, side);
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			uint64_t word = mask[i];
+			while (word != 0)
+			{
+				func(i * 64 + std::countr_zero(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+	/**
+	 * @brief Appends an empty mask and returns its index, used while compiling the table
+	 */
+	int add_mask();
+
+	uint64_t* get_mask_words(const int mask_idx) { return m_mask_words.data() + static_cast<size_t>(mask_idx) * m_word_count; }
+
+	/**
+	 * @brief Points tile_id's rules on the given side to a mask added with add_mask
+	 */
+	void set_mask(const int tile_id, const int side, const int mask_idx) { m_mask_indices[tile_id * m_number_of_sides + side] = mask_idx; }
+
+	/**
+	 * @brief Computes the per tile and side support counts, call after all masks were set
+	 */
+	void finalize();
+
+private:
+	int m_tile_count;
+	int m_number_of_sides;
+	int m_word_count;
+	int m_mask_count = 0;
+
+	// views used by the accessors, point into the vectors below or into m_storage
+	const uint64_t* m_mask_data = nullptr;
+	const int32_t* m_mask_index_data = nullptr;
+	const int32_t* m_support_count_data = nullptr;
+	std::shared_ptr<const void> m_storage;
+
+	vector<uint64_t> m_mask_words;
+	// m_mask_indices[tile_id * sides + side] = index of the tile's mask in m_mask_words
+	vector<int> m_mask_indices;
+	vector<int> m_support_counts;
+};
@@ -0,0 +1,40 @@
+#include "AliasTable.h"
+
+#include <numeric>
+
+AliasTable::AliasTable(const vector<float>& weights)
+	: m_probabilities(weights.size(), 1), m_aliases(weights.size())
+{
+	const int count = static_cast<int>(weights.size());
+	const double weight_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+	// scale so the average is 1, then fill every underfull slot from an overfull one
+	vector<double> scaled(count);
+	vector<int> small;
+	vector<int> large;
+	for (int i = 0; i < count; ++i)
+	{
+		m_aliases[i] = i;
+		scaled[i] = weights[i] * count / weight_sum;
+		(scaled[i] < 1 ? small : large).push_back(i);
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		const int less = small.back();
+		small.pop_back();
+		const int more = large.back();
+
+		m_probabilities[less] = scaled[less];
+		m_aliases[less] = more;
+
+		scaled[more] -= 1 - scaled[less];
+		if (scaled[more] < 1)
+		{
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+
+	// whatever is left is 1 up to rounding errors and keeps its own index
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "Util/Random.h"
+
+using std::vector;
+
+/**
+ * @class AliasTable
+ * @brief Walker/Vose alias table, samples an index with probability proportional to its weight in O(1)
+ */
+class AliasTable
+{
+public:
+	AliasTable() = default;
+
+	/**
+	 * @param weights Non-negative weights with a positive sum
+	 */
+	explicit AliasTable(const vector<float>& weights);
+
+	int size() const { return static_cast<int>(m_probabilities.size()); }
+
+	template <typename Engine>
+	int sample(Engine& engine) const
+	{
+		const int idx = random_below(engine, size());
+		return random_unit(engine) < m_probabilities[idx] ? idx : m_aliases[idx];
+	}
+
+private:
+	// probability of keeping idx instead of taking its alias
+	vector<double> m_probabilities;
+	vector<int> m_aliases;
+};
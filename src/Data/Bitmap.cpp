@@ -0,0 +1,87 @@
+#include "Bitmap.h"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr const char* PPM_MAGIC = "P6";
+static constexpr int PPM_MAX_VALUE = 255;
+
+// Reads the next header number, skipping whitespace and # comments
+static bool read_header_value(std::ifstream& file, int& value)
+{
+	while (file >> std::ws && file.peek() == '#')
+	{
+		string comment;
+		std::getline(file, comment);
+	}
+
+	return static_cast<bool>(file >> value);
+}
+
+std::optional<Bitmap> Bitmap::load_ppm(const string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return std::nullopt;
+	}
+
+	string magic;
+	int width = 0, height = 0, max_value = 0;
+	file >> magic;
+	if (magic != PPM_MAGIC || !read_header_value(file, width) || !read_header_value(file, height) || !read_header_value(file, max_value)
+		|| width <= 0 || height <= 0 || max_value != PPM_MAX_VALUE)
+	{
+		std::cerr << "Not a binary PPM with 8 bits per channel: " << path << std::endl;
+		return std::nullopt;
+	}
+	// a single whitespace character separates the header from the pixels
+	file.get();
+
+	Bitmap bitmap(width, height);
+	vector<uint8_t> row(static_cast<size_t>(width) * 3);
+	for (int y = 0; y < height; ++y)
+	{
+		if (!file.read(reinterpret_cast<char*>(row.data()), static_cast<std::streamsize>(row.size())))
+		{
+			std::cerr << "Truncated PPM file: " << path << std::endl;
+			return std::nullopt;
+		}
+
+		for (int x = 0; x < width; ++x)
+		{
+			const uint8_t* rgb = row.data() + x * 3;
+			bitmap.set_pixel(x, y, uint32_t{rgb[0]} << 16 | uint32_t{rgb[1]} << 8 | rgb[2]);
+		}
+	}
+
+	return bitmap;
+}
+
+bool Bitmap::write_ppm(const string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return false;
+	}
+
+	file << PPM_MAGIC << "\n" << width << " " << height << "\n" << PPM_MAX_VALUE << "\n";
+
+	vector<char> row(static_cast<size_t>(width) * 3);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const uint32_t color = get_pixel(x, y);
+			row[x * 3] = static_cast<char>(color >> 16 & 0xFF);
+			row[x * 3 + 1] = static_cast<char>(color >> 8 & 0xFF);
+			row[x * 3 + 2] = static_cast<char>(color & 0xFF);
+		}
+		file.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * @struct Bitmap
+ * @brief RGB image in row-major order, each pixel packed as 0xRRGGBB. Read and written as binary PPM (P6) files,
+ * which any image editor can export, so sample images don't need openFrameworks to be decoded
+ */
+struct Bitmap
+{
+	int width = 0;
+	int height = 0;
+	vector<uint32_t> pixels;
+
+	Bitmap() = default;
+	Bitmap(const int width, const int height) : width(width), height(height), pixels(static_cast<size_t>(width) * height) {}
+
+	uint32_t get_pixel(const int x, const int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+	void set_pixel(const int x, const int y, const uint32_t color) { pixels[static_cast<size_t>(y) * width + x] = color; }
+
+	/**
+	 * @brief Loads a binary PPM file with 8 bits per channel
+	 * @return nullopt if the file is missing or isn't such a PPM
+	 */
+	static std::optional<Bitmap> load_ppm(const string& path);
+
+	bool write_ppm(const string& path) const;
+};
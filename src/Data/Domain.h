@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @class Domain
+ * @brief Fixed-width bitset over dense tile IDs, bit i is set iff tile ID i is still possible.
+ * Tile sets of up to INLINE_WORDS * 64 tiles are stored inline without heap allocations,
+ * larger tile sets fall back to heap allocated words.
+ */
+class Domain
+{
+public:
+	static constexpr int BITS_PER_WORD = 64;
+	static constexpr int INLINE_WORDS = 2;
+
+	Domain() = default;
+
+	/**
+	 * @brief Constructs a domain able to hold tile IDs [0, size)
+	 * @param size Number of tile IDs in the tile set
+	 * @param fill If true all tile IDs are set, otherwise the domain is empty
+	 */
+	explicit Domain(const int size, const bool fill = false) : m_size(size), m_word_count(words_for(size))
+	{
+		if (m_word_count > INLINE_WORDS)
+		{
+			m_heap_words.resize(m_word_count, 0);
+		}
+
+		if (fill)
+		{
+			set_all();
+		}
+	}
+
+	static int words_for(const int size) { return (size + BITS_PER_WORD - 1) / BITS_PER_WORD; }
+
+	int size() const { return m_size; }
+	int word_count() const { return m_word_count; }
+
+	uint64_t* words() { return m_heap_words.empty() ? m_inline_words.data() : m_heap_words.data(); }
+	const uint64_t* words() const { return m_heap_words.empty() ? m_inline_words.data() : m_heap_words.data(); }
+
+	bool test(const int id) const { return (words()[id / BITS_PER_WORD] >> (id % BITS_PER_WORD)) & 1; }
+	void set(const int id) { words()[id / BITS_PER_WORD] |= uint64_t{1} << (id % BITS_PER_WORD); }
+	void reset(const int id) { words()[id / BITS_PER_WORD] &= ~(uint64_t{1} << (id % BITS_PER_WORD)); }
+
+	void clear()
+	{
+		uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			w[i] = 0;
+		}
+	}
+
+	void set_all()
+	{
+		uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			w[i] = ~uint64_t{0};
+		}
+
+		// keep the bits past the last tile ID cleared so count() stays exact
+		if (const int tail_bits = m_size % BITS_PER_WORD; tail_bits != 0)
+		{
+			w[m_word_count - 1] = (uint64_t{1} << tail_bits) - 1;
+		}
+	}
+
+	/**
+	 * @brief Returns the number of set tile IDs
+	 */
+	int count() const
+	{
+		const uint64_t* w = words();
+		int result = 0;
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			result += std::popcount(w[i]);
+		}
+
+		return result;
+	}
+
+	bool empty() const
+	{
+		const uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			if (w[i] != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Returns the lowest set tile ID if any
+	 */
+	std::optional<int> first() const
+	{
+		const uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			if (w[i] != 0)
+			{
+				return i * BITS_PER_WORD + std::countr_zero(w[i]);
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief Calls func(tile_id) for every set tile ID in ascending order.
+	 * Each word is read before its bits are visited, so func may reset the visited tile ID.
+	 */
+	template <typename Func>
+	void for_each(Func&& func) const
+	{
+		const uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			uint64_t word = w[i];
+			while (word != 0)
+			{
+				func(i * BITS_PER_WORD + std::countr_zero(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+	/**
+	 * @brief Returns true iff any tile ID is set both in this domain and in the mask
+	 * @param mask word_count() words, e.g. a mask from AdjacencyTable
+	 */
+	bool intersects(const uint64_t* mask) const
+	{
+		const uint64_t* w = words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			if ((w[i] & mask[i]) != 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool operator==(const Domain& other) const
+	{
+		if (m_size != other.m_size)
+		{
+			return false;
+		}
+
+		const uint64_t* w = words();
+		const uint64_t* other_w = other.words();
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			if (w[i] != other_w[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	int m_size = 0;
+	int m_word_count = 0;
+
+	std::array<uint64_t, INLINE_WORDS> m_inline_words{};
+	vector<uint64_t> m_heap_words;
+};
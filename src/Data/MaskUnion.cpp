@@ -0,0 +1,57 @@
+#include "MaskUnion.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "Util/DomainKernels.h"
+
+MaskUnion::MaskUnion(const AdjacencyTable& adjacency)
+	: m_adjacency{adjacency}, m_words(adjacency.get_word_count()), m_mask_stamps(adjacency.get_mask_count(), 0)
+{
+}
+
+const uint64_t* MaskUnion::compute(const uint64_t* domain_words, const int side)
+{
+	if (++m_stamp == 0)
+	{
+		// wrapped around, stamps of old unions could match again
+		std::fill(m_mask_stamps.begin(), m_mask_stamps.end(), 0);
+		m_stamp = 1;
+	}
+
+	const int word_count = m_adjacency.get_word_count();
+	std::fill(m_words.begin(), m_words.end(), 0);
+
+	// a single word is cheaper to OR in than to look up its stamp and call a kernel
+	if (word_count == 1)
+	{
+		uint64_t word = domain_words[0];
+		while (word != 0)
+		{
+			m_words[0] |= m_adjacency.get_mask(std::countr_zero(word), side)[0];
+			word &= word - 1;
+		}
+
+		return m_words.data();
+	}
+
+	for (int i = 0; i < word_count; ++i)
+	{
+		uint64_t word = domain_words[i];
+		while (word != 0)
+		{
+			const int tile_id = i * 64 + std::countr_zero(word);
+			word &= word - 1;
+
+			uint32_t& mask_stamp = m_mask_stamps[m_adjacency.get_mask_index(tile_id, side)];
+			if (mask_stamp == m_stamp)
+			{
+				continue;
+			}
+			mask_stamp = m_stamp;
+			DomainKernels::union_into(m_words.data(), m_adjacency.get_mask(tile_id, side), word_count);
+		}
+	}
+
+	return m_words.data();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AdjacencyTable.h"
+
+using std::vector;
+
+/**
+ * @class MaskUnion
+ * @brief Computes the union of the masks of every tile in a domain on one side, the tiles a neighbor there may keep.
+ * Tiles sharing an edge share their mask, so each distinct mask is ORed in once, with the DomainKernels.
+ * The cost is the number of distinct masks times the mask width rather than the number of tiles times the mask width
+ */
+class MaskUnion
+{
+public:
+	explicit MaskUnion(const AdjacencyTable& adjacency);
+
+	/**
+	 * @brief Returns the union's get_word_count() words, valid until the next call
+	 */
+	const uint64_t* compute(const uint64_t* domain_words, int side);
+
+private:
+	const AdjacencyTable& m_adjacency;
+	vector<uint64_t> m_words;
+	// m_mask_stamps[mask_idx] == m_stamp iff the mask is already in the current union
+	vector<uint32_t> m_mask_stamps;
+	uint32_t m_stamp = 0;
+};
@@ -0,0 +1,283 @@
+#include "OverlappingModel.h"
+
+#include <algorithm>
+
+// Bases of the 2D polynomial rolling hash, along rows and then along columns, arithmetic is modulo 2^64.
+// Equal hashes are only candidates, patterns are compared pixel by pixel before being merged
+static constexpr uint64_t ROW_HASH_BASE = 0x100000001B3ULL;
+static constexpr uint64_t COLUMN_HASH_BASE = 0x9E3779B97F4A7C15ULL;
+
+static constexpr int MAX_SYMMETRY = 8;
+
+namespace
+{
+	// Palette indices of an image in row-major order
+	struct IndexedImage
+	{
+		int width = 0;
+		int height = 0;
+		vector<int> pixels;
+
+		int get(const int x, const int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+	};
+
+	// 90 degrees clockwise
+	IndexedImage rotate(const IndexedImage& image)
+	{
+		IndexedImage rotated{image.height, image.width, vector<int>(image.pixels.size())};
+		for (int y = 0; y < rotated.height; ++y)
+		{
+			for (int x = 0; x < rotated.width; ++x)
+			{
+				rotated.pixels[static_cast<size_t>(y) * rotated.width + x] = image.get(y, image.height - 1 - x);
+			}
+		}
+		return rotated;
+	}
+
+	// Mirrors left and right
+	IndexedImage reflect(const IndexedImage& image)
+	{
+		IndexedImage reflected{image.width, image.height, vector<int>(image.pixels.size())};
+		for (int y = 0; y < image.height; ++y)
+		{
+			for (int x = 0; x < image.width; ++x)
+			{
+				reflected.pixels[static_cast<size_t>(y) * image.width + x] = image.get(image.width - 1 - x, y);
+			}
+		}
+		return reflected;
+	}
+
+	// Signature of the pixels a pattern shares with its neighbor on one side
+	struct SlabHash
+	{
+		size_t operator()(const vector<int>& slab) const
+		{
+			uint64_t hash = 0;
+			for (const int pixel : slab)
+			{
+				hash = hash * ROW_HASH_BASE + static_cast<uint64_t>(pixel) + 1;
+			}
+			return static_cast<size_t>(hash ^ hash >> 32);
+		}
+	};
+}
+
+OverlappingModel::OverlappingModel(const Bitmap& sample, const Settings& settings)
+	: m_pattern_size(std::max(settings.pattern_size, 1))
+{
+	IndexedImage image{sample.width, sample.height, vector<int>(sample.pixels.size())};
+
+	std::unordered_map<uint32_t, int> color_ids;
+	for (size_t i = 0; i < sample.pixels.size(); ++i)
+	{
+		const auto [it, is_new] = color_ids.try_emplace(sample.pixels[i], static_cast<int>(m_palette.size()));
+		if (is_new)
+		{
+			m_palette.push_back(sample.pixels[i]);
+		}
+		image.pixels[i] = it->second;
+	}
+
+	std::unordered_multimap<uint64_t, int> pattern_ids;
+	const int symmetry = std::clamp(settings.symmetry, 1, MAX_SYMMETRY);
+
+	// even variants are the rotations of the sample, odd ones their reflections
+	IndexedImage rotated = image;
+	for (int i = 0; i < symmetry; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			if (i > 0)
+			{
+				rotated = rotate(rotated);
+			}
+			extract_patterns(rotated.pixels, rotated.width, rotated.height, settings.is_periodic_input, pattern_ids);
+		}
+		else
+		{
+			const IndexedImage reflected = reflect(rotated);
+			extract_patterns(reflected.pixels, reflected.width, reflected.height, settings.is_periodic_input, pattern_ids);
+		}
+	}
+}
+
+void OverlappingModel::extract_patterns(const vector<int>& image, const int width, const int height, const bool is_periodic,
+	std::unordered_multimap<uint64_t, int>& pattern_ids)
+{
+	const int n = m_pattern_size;
+	const int window_cols = is_periodic ? width : width - n + 1;
+	const int window_rows = is_periodic ? height : height - n + 1;
+	if (window_cols <= 0 || window_rows <= 0)
+	{
+		return;
+	}
+
+	// the image extended by the pixels it wraps around to, so every window is a contiguous block
+	const int extended_width = window_cols + n - 1;
+	const int extended_height = window_rows + n - 1;
+	vector<int> extended(static_cast<size_t>(extended_width) * extended_height);
+	for (int y = 0; y < extended_height; ++y)
+	{
+		for (int x = 0; x < extended_width; ++x)
+		{
+			extended[static_cast<size_t>(y) * extended_width + x] = image[static_cast<size_t>(y % height) * width + x % width];
+		}
+	}
+
+	// pixel values start at 1, so index 0 still changes the hash
+	auto value = [&](const int x, const int y) { return static_cast<uint64_t>(extended[static_cast<size_t>(y) * extended_width + x]) + 1; };
+
+	uint64_t row_power = 1, column_power = 1;
+	for (int k = 1; k < n; ++k)
+	{
+		row_power *= ROW_HASH_BASE;
+		column_power *= COLUMN_HASH_BASE;
+	}
+
+	// row_hashes[y * window_cols + x] = hash of the n pixels of row y starting at column x
+	vector<uint64_t> row_hashes(static_cast<size_t>(extended_height) * window_cols);
+	for (int y = 0; y < extended_height; ++y)
+	{
+		uint64_t hash = 0;
+		for (int k = 0; k < n; ++k)
+		{
+			hash = hash * ROW_HASH_BASE + value(k, y);
+		}
+
+		for (int x = 0; x < window_cols; ++x)
+		{
+			row_hashes[static_cast<size_t>(y) * window_cols + x] = hash;
+			if (x + 1 < window_cols)
+			{
+				hash = (hash - value(x, y) * row_power) * ROW_HASH_BASE + value(x + n, y);
+			}
+		}
+	}
+
+	// window_hashes[y * window_cols + x] = hash of the n row hashes below and including row y
+	vector<uint64_t> window_hashes(static_cast<size_t>(window_rows) * window_cols);
+	for (int x = 0; x < window_cols; ++x)
+	{
+		auto row_hash = [&](const int y) { return row_hashes[static_cast<size_t>(y) * window_cols + x]; };
+
+		uint64_t hash = 0;
+		for (int k = 0; k < n; ++k)
+		{
+			hash = hash * COLUMN_HASH_BASE + row_hash(k);
+		}
+
+		for (int y = 0; y < window_rows; ++y)
+		{
+			window_hashes[static_cast<size_t>(y) * window_cols + x] = hash;
+			if (y + 1 < window_rows)
+			{
+				hash = (hash - row_hash(y) * column_power) * COLUMN_HASH_BASE + row_hash(y + n);
+			}
+		}
+	}
+
+	for (int y = 0; y < window_rows; ++y)
+	{
+		for (int x = 0; x < window_cols; ++x)
+		{
+			const uint64_t hash = window_hashes[static_cast<size_t>(y) * window_cols + x];
+
+			const auto [begin, end] = pattern_ids.equal_range(hash);
+			const auto it = std::find_if(begin, end, [&](const auto& entry)
+			{
+				return is_same_pattern(entry.second, extended, extended_width, x, y);
+			});
+
+			if (it != end)
+			{
+				m_frequencies[it->second]++;
+				continue;
+			}
+
+			const int pattern_idx = get_pattern_count();
+			for (int row = 0; row < n; ++row)
+			{
+				const auto row_begin = extended.begin() + static_cast<ptrdiff_t>(y + row) * extended_width + x;
+				m_pattern_pixels.insert(m_pattern_pixels.end(), row_begin, row_begin + n);
+			}
+			m_frequencies.push_back(1);
+			pattern_ids.emplace(hash, pattern_idx);
+		}
+	}
+}
+
+bool OverlappingModel::is_same_pattern(const int pattern_idx, const vector<int>& image, const int image_width, const int x, const int y) const
+{
+	const int* pattern = get_pattern(pattern_idx);
+	for (int row = 0; row < m_pattern_size; ++row)
+	{
+		const auto row_begin = image.begin() + static_cast<ptrdiff_t>(y + row) * image_width + x;
+		if (!std::equal(row_begin, row_begin + m_pattern_size, pattern + row * m_pattern_size))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// A pattern's edge on a side is the label of the slab it shares with its neighbor there: on the right its columns
+// 1..n-1, which the right neighbor has as columns 0..n-2, i.e. as its left edge. So the TileSet's buckets of equal
+// opposite edges are exactly the overlapping patterns, without comparing every pair of patterns
+TileSet OverlappingModel::make_tile_set() const
+{
+	const int n = m_pattern_size;
+
+	// row slabs are the top and bottom edges, column slabs the left and right ones, each with its own labels
+	std::unordered_map<vector<int>, int, SlabHash> row_slab_ids, column_slab_ids;
+
+	auto get_slab_label = [&](std::unordered_map<vector<int>, int, SlabHash>& slab_ids, const int* pattern,
+		const int first_row, const int first_col, const int rows, const int cols)
+	{
+		vector<int> slab;
+		slab.reserve(static_cast<size_t>(rows) * cols);
+		for (int row = first_row; row < first_row + rows; ++row)
+		{
+			slab.insert(slab.end(), pattern + row * n + first_col, pattern + row * n + first_col + cols);
+		}
+
+		const auto [it, _] = slab_ids.try_emplace(std::move(slab), static_cast<int>(slab_ids.size()));
+		return std::to_string(it->second);
+	};
+
+	// zero padded names sort like the pattern indices, so the tile IDs are the pattern indices
+	const size_t name_digits = std::to_string(std::max(get_pattern_count() - 1, 0)).size();
+
+	unordered_map<string, TileSet::TileData> tiles;
+	for (int pattern_idx = 0; pattern_idx < get_pattern_count(); ++pattern_idx)
+	{
+		const int* pattern = get_pattern(pattern_idx);
+
+		vector<string> edges(TileSet::NUMBER_OF_SIDES);
+		edges[TileSet::TOP_SIDE_IDX] = get_slab_label(row_slab_ids, pattern, 0, 0, n - 1, n);
+		edges[TileSet::BOTTOM_SIDE_IDX] = get_slab_label(row_slab_ids, pattern, 1, 0, n - 1, n);
+		edges[TileSet::LEFT_SIDE_IDX] = get_slab_label(column_slab_ids, pattern, 0, 0, n, n - 1);
+		edges[TileSet::RIGHT_SIDE_IDX] = get_slab_label(column_slab_ids, pattern, 0, 1, n, n - 1);
+
+		const string idx_str = std::to_string(pattern_idx);
+		const string name = string("p").append(name_digits - idx_str.size(), '0').append(idx_str);
+		tiles[name] = TileSet::TileData{TileSet::SYMMETRY_TYPE_X, static_cast<float>(get_frequency(pattern_idx)), std::move(edges), name, 0};
+	}
+
+	return TileSet(tiles, TileSet::NUMBER_OF_SIDES, false);
+}
+
+Bitmap OverlappingModel::render(const vector<int>& tile_ids, const int width, const int height) const
+{
+	Bitmap bitmap(width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const int tile_id = tile_ids[static_cast<size_t>(y) * width + x];
+			bitmap.set_pixel(x, y, tile_id >= 0 ? m_palette[get_pattern(tile_id)[0]] : 0);
+		}
+	}
+	return bitmap;
+}
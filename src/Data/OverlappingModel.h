@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bitmap.h"
+#include "TileSet.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @class OverlappingModel
+ * @brief Extracts the N x N patterns of a sample image, including its rotations and reflections, as an alternative to
+ * hand-authored tile sets. Every pattern becomes a tile weighted by how often it occurs, and two patterns may be
+ * neighbors if they overlap, i.e. agree on the N x (N-1) pixels they share when one is shifted by a pixel.
+ * Patterns are deduplicated by a rolling hash of every window of the sample, and overlaps are found by hashing each
+ * pattern's edge slabs into labels of the TileSet's edge buckets, so both are linear in the sample and pattern count
+ */
+class OverlappingModel
+{
+public:
+	struct Settings
+	{
+		// width and height of the patterns in pixels
+		int pattern_size = 3;
+		// whether the sample wraps around, so windows crossing its right and bottom edges are extracted too
+		bool is_periodic_input = true;
+		// number of the sample's 8 rotations and reflections the patterns are extracted from, 1 for the sample as is
+		int symmetry = 8;
+	};
+
+	OverlappingModel(const Bitmap& sample, const Settings& settings);
+
+	int get_pattern_count() const {return static_cast<int>(m_frequencies.size());}
+	int get_pattern_size() const {return m_pattern_size;}
+	int get_frequency(const int pattern_idx) const {return m_frequencies[pattern_idx];}
+
+	/**
+	 * @brief Returns the pattern's pattern_size * pattern_size palette indices in row-major order
+	 */
+	const int* get_pattern(const int pattern_idx) const {return m_pattern_pixels.data() + static_cast<size_t>(pattern_idx) * m_pattern_size * m_pattern_size;}
+
+	// Distinct colors of the sample, indexed by the patterns' pixels
+	const vector<uint32_t>& get_palette() const {return m_palette;}
+
+	/**
+	 * @brief Creates the tile set of the patterns for the solvers, tile ID i is pattern i
+	 */
+	TileSet make_tile_set() const;
+
+	/**
+	 * @brief Renders a generated map, each cell is the top left pixel of its pattern and black if it didn't collapse
+	 */
+	Bitmap render(const vector<int>& tile_ids, int width, int height) const;
+
+private:
+	int m_pattern_size;
+	vector<uint32_t> m_palette;
+	// flat pattern table, pattern i's pixels start at i * pattern_size^2
+	vector<int> m_pattern_pixels;
+	vector<int> m_frequencies;
+
+	/**
+	 * @brief Adds every pattern_size x pattern_size window of the palette indexed image, or increments the frequency
+	 * of the pattern it duplicates. pattern_ids maps the windows' rolling hashes to the patterns with that hash
+	 */
+	void extract_patterns(const vector<int>& image, int width, int height, bool is_periodic,
+		std::unordered_multimap<uint64_t, int>& pattern_ids);
+
+	// Compares the pattern to the window with its top left pixel at x, y
+	bool is_same_pattern(int pattern_idx, const vector<int>& image, int image_width, int x, int y) const;
+};
@@ -1,11 +1,25 @@
 #include "Tile.h"
 
-void remove_possible_tile()
+#include <cmath>
+
+void Tile::remove_possible_tile(const int tile_id, const double weight, const double weight_log_weight)
+{
+	domain.reset(tile_id);
+	possible_tile_count--;
+	weight_sum -= weight;
+	weight_log_weight_sum -= weight_log_weight;
+}
+
+void Tile::add_possible_tile(const int tile_id, const double weight, const double weight_log_weight)
 {
-	
+	domain.set(tile_id);
+	possible_tile_count++;
+	weight_sum += weight;
+	weight_log_weight_sum += weight_log_weight;
 }
 
-void update_constraints()
+// H = -sum(p*log(p)) with p = w/W, which simplifies to log(W) - sum(w*log(w))/W
+double Tile::get_entropy() const
 {
-	
+	return std::log(weight_sum) - weight_log_weight_sum / weight_sum;
 }
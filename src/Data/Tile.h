@@ -1,13 +1,8 @@
 #pragma once
 
-#include <string>
-#include <vector>
-#include <unordered_set>
 #include <optional>
 
-using std::string;
-using std::vector;
-using std::unordered_set;
+#include "Domain.h"
 
 /**
  * @class Tile
@@ -16,23 +11,49 @@ using std::unordered_set;
 class Tile
 {
 public:
-	unordered_set<string> domain;
-	
-	Tile(const unordered_set<string>& possible_tiles) : domain(possible_tiles){}
+	// bit i is set iff tile ID i (see TileSet::get_name) is still possible for this tile
+	Domain domain;
+
+	// Number of set tile IDs in domain, kept up to date by remove_possible_tile
+	int possible_tile_count;
+
+	// Running sums of w and w*log(w) over the domain's tiles, kept up to date by remove_possible_tile
+	double weight_sum;
+	double weight_log_weight_sum;
+
+	Tile(const Domain& possible_tiles, const double weight_sum, const double weight_log_weight_sum)
+		: domain(possible_tiles), possible_tile_count(possible_tiles.count()), weight_sum(weight_sum), weight_log_weight_sum(weight_log_weight_sum){}
+
+	/**
+	 * @brief Removes a possible tile from the domain and its weight from the running sums
+	 * @param weight The tile's weight, w
+	 * @param weight_log_weight The tile's precomputed w*log(w)
+	 */
+	void remove_possible_tile(int tile_id, double weight, double weight_log_weight);
+
+	/**
+	 * @brief Adds a removed tile back to the domain and its weight to the running sums, undoes remove_possible_tile
+	 */
+	void add_possible_tile(int tile_id, double weight, double weight_log_weight);
+
+	/**
+	 * @brief Returns the Shannon entropy of the domain, computed in O(1) from the running sums
+	 */
+	double get_entropy() const;
 
 	/**
 	 * @brief Returns true iff one possible tile remains for this tile
 	 */
-	bool is_collapsed() const { return domain.size() == 1; }
-	
+	bool is_collapsed() const { return possible_tile_count == 1; }
+
 	/**
 	 * @brief Returns true if no possible tiles remain for this tile and false otherwise
 	 */
-	bool is_domain_empty() const { return domain.empty(); }
-	
+	bool is_domain_empty() const { return possible_tile_count == 0; }
+
 	/**
-	 * @brief returns the name of the collapsed tile iff the tile is collapsed
-	 * @return string only if the tile collapsed
+	 * @brief returns the ID of the collapsed tile iff the tile is collapsed
+	 * @return tile ID only if the tile collapsed
 	 */
-	std::optional<string> get_collapsed_name() const { return is_collapsed() ? std::make_optional(*domain.begin()) : std::nullopt; }
+	std::optional<int> get_collapsed_id() const { return is_collapsed() ? domain.first() : std::nullopt; }
 };
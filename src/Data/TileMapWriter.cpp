@@ -0,0 +1,121 @@
+#include "TileMapWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// little-endian, independent of the host's byte order
+static void write_uint(std::ofstream& file, const uint32_t value, const int bytes)
+{
+	char buffer[4];
+	for (int i = 0; i < bytes; ++i)
+	{
+		buffer[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+	}
+	file.write(buffer, bytes);
+}
+
+// A row source reading from a map that's already in memory
+static TileMapWriter::RowSource make_row_source(const int width, const vector<int>& tile_ids)
+{
+	return [width, &tile_ids](const int row, vector<int>& row_ids)
+	{
+		std::copy_n(tile_ids.begin() + static_cast<size_t>(row) * width, width, row_ids.begin());
+	};
+}
+
+bool TileMapWriter::write(const string& path, const Format format, const int width, const int height, const int tile_count, const vector<int>& tile_ids)
+{
+	return write(path, format, width, height, tile_count, make_row_source(width, tile_ids));
+}
+
+bool TileMapWriter::write_csv(const string& path, const int width, const int height, const vector<int>& tile_ids)
+{
+	return write_csv(path, width, height, make_row_source(width, tile_ids));
+}
+
+bool TileMapWriter::write_binary(const string& path, const int width, const int height, const int tile_count, const vector<int>& tile_ids)
+{
+	return write_binary(path, width, height, tile_count, make_row_source(width, tile_ids));
+}
+
+bool TileMapWriter::write(const string& path, const Format format, const int width, const int height, const int tile_count, const RowSource& row_source)
+{
+	return format == Format::Csv ? write_csv(path, width, height, row_source) : write_binary(path, width, height, tile_count, row_source);
+}
+
+bool TileMapWriter::write_csv(const string& path, const int width, const int height, const RowSource& row_source)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return false;
+	}
+
+	vector<int> row_ids(width);
+	for (int row = 0; row < height; ++row)
+	{
+		row_source(row, row_ids);
+		for (int col = 0; col < width; ++col)
+		{
+			if (col > 0)
+			{
+				file << ',';
+			}
+			file << row_ids[col];
+		}
+		file << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool TileMapWriter::write_binary(const string& path, const int width, const int height, const int tile_count, const RowSource& row_source)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return false;
+	}
+
+	const int bytes_per_cell = tile_count < 0xFFFF ? 2 : 4;
+
+	file.write(BINARY_MAGIC, std::strlen(BINARY_MAGIC));
+	write_uint(file, BINARY_VERSION, 4);
+	write_uint(file, width, 4);
+	write_uint(file, height, 4);
+	write_uint(file, bytes_per_cell, 4);
+
+	vector<int> row_ids(width);
+	for (int row = 0; row < height; ++row)
+	{
+		row_source(row, row_ids);
+		for (const int tile_id : row_ids)
+		{
+			write_uint(file, static_cast<uint32_t>(tile_id), bytes_per_cell);
+		}
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool TileMapWriter::write_tile_names(const string& path, const vector<string>& tile_names)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open file: " << path << std::endl;
+		return false;
+	}
+
+	for (const string& name : tile_names)
+	{
+		file << name << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * @class TileMapWriter
+ * @brief Writes a generated grid of tile IDs to disk.
+ * CSV files hold one map row per line. Binary files hold a header (see BINARY_MAGIC) followed by
+ * width * height little-endian cells of bytes_per_cell bytes, 2 if the tile IDs fit in 16 bits and 4 otherwise.
+ * Uncollapsed cells are written as -1 in CSV and as all bits set in binary
+ */
+class TileMapWriter
+{
+public:
+	static constexpr const char* BINARY_MAGIC = "WFCM";
+	static constexpr unsigned int BINARY_VERSION = 1;
+
+	enum class Format { Csv, Binary };
+
+	/**
+	 * @brief Fills row_ids, already sized to the map width, with the tile IDs of the given row.
+	 * Lets maps that don't fit in memory be streamed to disk row by row
+	 */
+	using RowSource = std::function<void(int row, vector<int>& row_ids)>;
+
+	static bool write(const string& path, Format format, int width, int height, int tile_count, const vector<int>& tile_ids);
+	static bool write_csv(const string& path, int width, int height, const vector<int>& tile_ids);
+	static bool write_binary(const string& path, int width, int height, int tile_count, const vector<int>& tile_ids);
+
+	static bool write(const string& path, Format format, int width, int height, int tile_count, const RowSource& row_source);
+	static bool write_csv(const string& path, int width, int height, const RowSource& row_source);
+	static bool write_binary(const string& path, int width, int height, int tile_count, const RowSource& row_source);
+
+	/**
+	 * @brief Writes the tile names, one per line, so that line i names tile ID i
+	 */
+	static bool write_tile_names(const string& path, const vector<string>& tile_names);
+
+	static const char* get_extension(const Format format) { return format == Format::Csv ? ".csv" : ".bin"; }
+};
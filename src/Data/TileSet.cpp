@@ -1,10 +1,12 @@
 #include "TileSet.h"
 
-#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <ranges>
 
 #include "pugixml.hpp"
-#include "ofMain.h"
 
 using pugi::xml_node;
 using pugi::xml_document;
@@ -21,16 +23,83 @@ static constexpr const char* VALUE_ATTRIBUTE_NAME = "value";
 static constexpr const char* TILE_ATTRIBUTE_NAME = "tile";
 static constexpr const char* NAME_ATTRIBUTE_NAME = "name";
 static constexpr const char* SIDE_ATTRIBUTE_NAME = "side";
+static constexpr const char* SIDES_ATTRIBUTE_NAME = "sides";
 
-TileSet::TileSet(const string& xml_path, const string& images_folder_path)
+TileSet::TileSet(const string& xml_path)
 {
-	SetData set_data = parse_set_data(xml_path);
+	load(parse_set_data(xml_path));
+}
+
+TileSet::TileSet(const string& xml_path, const string& cache_path)
+	: m_cache_path(cache_path), m_source_hash(TileSetCache::hash_sources(xml_path))
+{
+	if (std::shared_ptr<const TileSetCache> cache = TileSetCache::open(cache_path, m_source_hash))
+	{
+		load_cache(cache);
+		return;
+	}
+
+	load(parse_set_data(xml_path));
+	// a set that failed to load isn't cached, it would load as a valid empty set
+	if (adjacency != nullptr && get_tile_count() > 0)
+	{
+		TileSetCache::write(cache_path, m_source_hash, *this);
+	}
+}
+
+TileSet::TileSet(const unordered_map<string, TileData>& tiles, const int number_of_sides, const bool is_rotated)
+{
+	load(SetData{tiles, number_of_sides, is_rotated});
+}
+
+void TileSet::load(const SetData& set_data)
+{
+	if (!is_supported_number_of_sides(set_data.number_of_sides))
+	{
+		std::cerr << "Unsupported number of sides: " << set_data.number_of_sides << std::endl;
+		return;
+	}
+
+	m_number_of_sides = set_data.number_of_sides;
 	m_set_data = add_rotated_tiles(set_data);
-	adjacency = load_adjacency_rules(m_set_data);
+	assign_tile_ids();
+	adjacency = load_adjacency_rules();
+}
+
+// Takes the compiled tiles from the cache, the adjacency rules use its mapped buffers in place
+void TileSet::load_cache(const std::shared_ptr<const TileSetCache>& cache)
+{
+	m_cache = cache;
+	m_number_of_sides = cache->get_number_of_sides();
+
+	for (int id = 0; id < cache->get_tile_count(); ++id)
+	{
+		m_tile_names.emplace_back(cache->get_name(id));
+		m_tile_ids[m_tile_names.back()] = id;
+		m_base_names.emplace_back(cache->get_base_name(id));
+		m_rotations.push_back(cache->get_rotation(id));
+		m_weights.push_back(cache->get_weight(id));
+		m_weight_log_weights.push_back(cache->get_weight_log_weight(id));
+	}
+
+	if (!m_weights.empty())
+	{
+		m_alias_table = AliasTable(m_weights);
+	}
 
-	images = load_set_images(images_folder_path);
+	adjacency = std::make_shared<AdjacencyTable>(get_tile_count(), m_number_of_sides, cache->get_mask_count(),
+		cache->get_mask_words(), cache->get_mask_indices(), cache->get_support_counts(), cache);
 }
 
+std::optional<TileSetCache::AtlasPixels> TileSet::get_cached_atlas() const
+{
+	return m_cache != nullptr ? m_cache->get_atlas() : std::nullopt;
+}
+
+bool TileSet::write_cached_atlas(const TileSetCache::AtlasPixels& atlas) const
+{
+	return !m_cache_path.empty() && TileSetCache::write(m_cache_path, m_source_hash, *this, &atlas);
+}
 
 TileSet::SetData TileSet::parse_set_data(const string& xml_path)
 {
@@ -46,6 +115,15 @@ TileSet::SetData TileSet::parse_set_data(const string& xml_path)
 	xml_node set_parent = doc.child(SET_ATTRIBUTE_NAME);
 	xml_node tiles_parent = set_parent.child(TILES_ATTRIBUTE_NAME);
 
+	// <set sides="6"> for hex and voxel sets, square otherwise
+	set_data.number_of_sides = set_parent.attribute(SIDES_ATTRIBUTE_NAME).as_int(NUMBER_OF_SIDES);
+	if (!is_supported_number_of_sides(set_data.number_of_sides))
+	{
+		std::cerr << "Unsupported number of sides: " << set_data.number_of_sides << " in " << xml_path << std::endl;
+		return SetData{};
+	}
+	const unordered_map<string, int>& side_names = set_data.number_of_sides == NUMBER_OF_SIDES ? SIDES : SIX_SIDES;
+
 	for (xml_node tile : tiles_parent.children(TILE_ATTRIBUTE_NAME))
 	{
 		string tile_name = tile.attribute(NAME_ATTRIBUTE_NAME).value();
@@ -54,50 +132,35 @@ TileSet::SetData TileSet::parse_set_data(const string& xml_path)
 		string weight_str = tile.attribute(WEIGHT_ATTRIBUTE_NAME).value();
 		float weight = weight_str.empty() ? DEFAULT_WEIGHT : atof(weight_str.c_str());
 
-		vector<string> edges_map{NUMBER_OF_SIDES};
+		vector<string> edges_map(set_data.number_of_sides);
 		xml_node edges_parent = tile.child(EDGES_ATTRIBUTE_NAME);
 
 		for (xml_node edge : edges_parent.children(EDGE_ATTRIBUTE_NAME))
 		{
 			string edge_side = edge.attribute(SIDE_ATTRIBUTE_NAME).value();
 
-			int edge_idx = SIDES.at(edge_side);
+			const auto side_it = side_names.find(edge_side);
+			if (side_it == side_names.end() || side_it->second >= set_data.number_of_sides)
+			{
+				std::cerr << "Unknown side \"" << edge_side << "\" of tile " << tile_name << " in " << xml_path << std::endl;
+				return SetData{};
+			}
+			const int edge_idx = side_it->second;
 
 			string edge_value = edge.attribute(VALUE_ATTRIBUTE_NAME).value();
 			edges_map[edge_idx] = edge_value;
 		}
 
-		set_data.tiles[tile_name] = TileData{symmetry_type, weight, edges_map};
+		set_data.tiles[tile_name] = TileData{symmetry_type, weight, edges_map, {}, 0};
 	}
 
 	return set_data;
 }
 
-TileSet::TileImages TileSet::load_set_images(const string& images_folder_path)
-{
-	TileImages images;
-	
-	if (!std::filesystem::exists(images_folder_path.c_str()))
-	{
-		std::cerr << "Failed to find folder: " << images_folder_path << std::endl;
-		return images;
-	}
-	
-	for (const auto& file : std::filesystem::directory_iterator(images_folder_path))
-	{
-		if (file.is_regular_file() && file.path().extension() == ".png")
-		{
-			images[file.path().stem()] = ofImage(file.path());
-		}
-	}
-	
-	return images;
-}
-
 vector<string> TileSet::rotate_edges_map(const vector<string>& edges_map, int rotate_by)
 {
 	vector<string> shifted_edges{NUMBER_OF_SIDES};
-	for (int i = 0; i < shifted_edges.size(); i++) {
+	for (int i = 0; i < static_cast<int>(shifted_edges.size()); i++) {
 		shifted_edges[rotate_side(i, rotate_by)] = edges_map[i];
 	}
 
@@ -107,7 +170,6 @@ vector<string> TileSet::rotate_edges_map(const vector<string>& edges_map, int ro
 void TileSet::add_tile_rotations(SetData& set_data, const pair<string, TileData>& tile_data)
 {
 	int n = symmetry_type_to_rotations.at(tile_data.second.symmetry_type);
-	float weight_sum = 0;
 
 	for (int i = 0; i < n; i++)
 	{
@@ -115,79 +177,160 @@ void TileSet::add_tile_rotations(SetData& set_data, const pair<string, TileData>
 		int tile_rotation = i*360/n;
 
 		if (n > 1) {
-			tile_name += "_" + std::to_string(tile_rotation);
+			tile_name.append("_").append(std::to_string(tile_rotation));
 		}
 
+		// the rotations share the tile's weight, so a tile's weight doesn't depend on its symmetry
 		set_data.tiles[tile_name] = TileData{
 			tile_data.second.symmetry_type,
-			tile_data.second.weight,
-			rotate_edges_map(tile_data.second.edges, tile_rotation)
+			tile_data.second.weight / n,
+			rotate_edges_map(tile_data.second.edges, tile_rotation),
+			tile_data.first,
+			tile_rotation
 		};
+	}
+}
+
+TileSet::SetData TileSet::add_rotated_tiles(const SetData& set_data)
+{
+	SetData set_data_with_symmetry{{}, set_data.number_of_sides, set_data.is_rotated};
+
+	// by name, so nothing depends on the hash map's iteration order
+	vector<pair<string, TileData>> tiles(set_data.tiles.begin(), set_data.tiles.end());
+	std::ranges::sort(tiles, {}, &pair<string, TileData>::first);
+
+	for (const auto& tile : tiles)
+	{
+		if (!set_data.is_rotated || set_data.number_of_sides != NUMBER_OF_SIDES)
+		{
+			// symmetry types describe square tiles, other tiles are used as defined
+			set_data_with_symmetry.tiles[tile.first] = TileData{SYMMETRY_TYPE_X, tile.second.weight, tile.second.edges, tile.first, 0};
+			continue;
+		}
+
+		add_tile_rotations(set_data_with_symmetry, tile);
+	}
+
+	return set_data_with_symmetry;
+}
+
+void TileSet::assign_tile_ids()
+{
+	m_tile_names.clear();
+	m_tile_ids.clear();
+	m_weights.clear();
+	m_base_names.clear();
+	m_rotations.clear();
+	m_weight_log_weights.clear();
+
+	for (const string& tile_name : m_set_data.tiles | std::views::keys)
+	{
+		m_tile_names.push_back(tile_name);
+	}
+
+	// sort names so IDs don't depend on the hash map's iteration order
+	std::ranges::sort(m_tile_names);
 
-		weight_sum += tile_data.second.weight;
+	for (int id = 0; id < get_tile_count(); ++id)
+	{
+		m_tile_ids[m_tile_names[id]] = id;
+		const TileData& tile_data = m_set_data.tiles.at(m_tile_names[id]);
+		const double weight = tile_data.weight;
+		m_weights.push_back(weight);
+		m_base_names.push_back(tile_data.base_name);
+		m_rotations.push_back(tile_data.rotation);
+		m_weight_log_weights.push_back(weight * std::log(weight));
 	}
 
-	// normalize weights
-	for (auto& tile : set_data.tiles)
+	if (!m_weights.empty())
 	{
-		tile.second.weight /= weight_sum;
+		m_alias_table = AliasTable(m_weights);
 	}
 }
 
-TileSet::SetData TileSet::add_rotated_tiles(const SetData& set_data)
+// Assigns an ID to every distinct edge label, returns edge_ids[tile_id * number of sides + side]
+vector<int> TileSet::intern_edges(int& edge_count) const
 {
-	SetData set_data_with_symmetry;
-	for (const auto& tile : set_data.tiles)
+	unordered_map<string, int> edge_label_ids;
+	vector<int> edge_ids(get_tile_count() * m_number_of_sides);
+
+	for (int tile_id = 0; tile_id < get_tile_count(); ++tile_id)
 	{
-		add_tile_rotations(set_data_with_symmetry, tile);
+		const TileData& tile_data = m_set_data.tiles.at(m_tile_names[tile_id]);
+		for (int i = 0; i < m_number_of_sides; i++)
+		{
+			const auto [it, _] = edge_label_ids.try_emplace(tile_data.edges[i], static_cast<int>(edge_label_ids.size()));
+			edge_ids[tile_id * m_number_of_sides + i] = it->second;
+		}
 	}
 
-	return set_data_with_symmetry;
+	edge_count = static_cast<int>(edge_label_ids.size());
+	return edge_ids;
 }
 
-// For each tile, adds to the adjacency list all tile names with an opposite matching side
-TileSet::AdjacencyRules TileSet::load_adjacency_rules(const SetData& set_data)
+// Buckets tiles by edge ID on each side, a tile allows on side i every tile in the bucket of its edge on the opposite side.
+// Tiles sharing an edge share the bucket's mask, so building the table is O(tiles * sides) plus the masks' size
+TileSet::AdjacencyRules TileSet::load_adjacency_rules() const
 {
-	AdjacencyRules rules;
-	for (const auto& [tile_name, tile_data] : set_data.tiles)
+	const int tile_count = get_tile_count();
+	int edge_count = 0;
+	const vector<int> edge_ids = intern_edges(edge_count);
+
+	auto rules = std::make_shared<AdjacencyTable>(tile_count, m_number_of_sides);
+
+	// bucket_masks[side * edge_count + edge_id] = index of the mask of tiles with edge_id on side
+	vector<int> bucket_masks(m_number_of_sides * edge_count, -1);
+	for (int tile_id = 0; tile_id < tile_count; ++tile_id)
 	{
-		for (const auto& [neighbor_tile_name, neighbor_tile_data] : set_data.tiles)
+		for (int i = 0; i < m_number_of_sides; i++)
 		{
-			for (int i=0; i < NUMBER_OF_SIDES; i++)
+			int& mask_idx = bucket_masks[i * edge_count + edge_ids[tile_id * m_number_of_sides + i]];
+			if (mask_idx < 0)
 			{
-				string set_tile_edge_value = tile_data.edges[i];
-				string neighbor_tile_opposite_edge_value = neighbor_tile_data.edges[opposite_side(i)];
-				if (set_tile_edge_value == neighbor_tile_opposite_edge_value)
-				{
-					if (!rules.contains(tile_name))
-					{
-						rules[tile_name] = vector<unordered_set<string>>(NUMBER_OF_SIDES);
-					}
+				mask_idx = rules->add_mask();
+			}
 
-					rules[tile_name][i].insert(neighbor_tile_name);
+			rules->get_mask_words(mask_idx)[tile_id / Domain::BITS_PER_WORD] |= uint64_t{1} << (tile_id % Domain::BITS_PER_WORD);
+		}
+	}
+
+	std::optional<int> empty_mask_idx;
+	for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+	{
+		for (int i = 0; i < m_number_of_sides; i++)
+		{
+			int mask_idx = bucket_masks[opposite_side(i, m_number_of_sides) * edge_count + edge_ids[tile_id * m_number_of_sides + i]];
+			if (mask_idx < 0)
+			{
+				// no tile has a matching opposite edge
+				if (!empty_mask_idx.has_value())
+				{
+					empty_mask_idx = rules->add_mask();
 				}
+				mask_idx = empty_mask_idx.value();
 			}
+
+			rules->set_mask(tile_id, i, mask_idx);
 		}
 	}
-	
+
+	rules->finalize();
 	return rules;
 }
 
 // Print adjacency rules in a human-readable format
-void TileSet::print_rules(const AdjacencyRules& rules)
+void TileSet::print_rules(const AdjacencyRules& rules) const
 {
-	for (const auto& [tile, sides] : rules)
+	for (int tile_id = 0; tile_id < rules->get_tile_count(); ++tile_id)
 	{
-		std::cout << tile << ":\n";
-		for (int j = 0; j < NUMBER_OF_SIDES; j++)
+		std::cout << get_name(tile_id) << ":\n";
+		for (int j = 0; j < m_number_of_sides; j++)
 		{
-			unordered_set<string> neighbors = sides[j];
-
 			std::cout << " " << j << ": [";
-			for (const string& neighbor : neighbors)
+			rules->for_each_allowed(tile_id, j, [&](const int neighbor_id)
 			{
-				std::cout << neighbor << ", ";
-			}
+				std::cout << get_name(neighbor_id) << ", ";
+			});
 			std::cout << "]\n";
 		}
 	}
@@ -4,14 +4,20 @@
 #include <vector>
 #include <string>
 #include <unordered_set>
+#include <memory>
+#include <utility>
 
-#include "ofMain.h"
+#include "Domain.h"
+#include "AdjacencyTable.h"
+#include "AliasTable.h"
+#include "TileSetCache.h"
 
 using std::string;
 using std::vector;
 using std::unordered_map;
 
 using std::unordered_set;
+using std::pair;
 
 /**
  * @class TileSet
@@ -20,33 +26,124 @@ using std::unordered_set;
 class TileSet
 {
 public:
-	// Constants with keys for the tiles' sides in the adjacency list
+	// Constants with keys for the tiles' sides in the adjacency list, square grids
 	static constexpr int NUMBER_OF_SIDES = 4;
 	static constexpr int TOP_SIDE_IDX = 0;
 	static constexpr int RIGHT_SIDE_IDX = 1;
 	static constexpr int BOTTOM_SIDE_IDX = 2;
 	static constexpr int LEFT_SIDE_IDX = 3;
 
-	// Maps tile name to it's image
-	using TileImages = unordered_map<string, ofImage>;
-	
-	// Maps tile name to its adjacency list in the for of rules[tile_name][side_constant] = allowed_tile_names_vector
-	using AdjacencyRules = unordered_map<string, vector<unordered_set<string>>>;
+	// Hex grids of pointy-top hexagons, clockwise from the upper right
+	static constexpr int HEX_NUMBER_OF_SIDES = 6;
+	static constexpr int HEX_NORTH_EAST_SIDE_IDX = 0;
+	static constexpr int HEX_EAST_SIDE_IDX = 1;
+	static constexpr int HEX_SOUTH_EAST_SIDE_IDX = 2;
+	static constexpr int HEX_SOUTH_WEST_SIDE_IDX = 3;
+	static constexpr int HEX_WEST_SIDE_IDX = 4;
+	static constexpr int HEX_NORTH_WEST_SIDE_IDX = 5;
+
+	// 3D voxel grids, north is the previous row and up the next layer
+	static constexpr int VOXEL_NUMBER_OF_SIDES = 6;
+	static constexpr int VOXEL_NORTH_SIDE_IDX = 0;
+	static constexpr int VOXEL_EAST_SIDE_IDX = 1;
+	static constexpr int VOXEL_UP_SIDE_IDX = 2;
+	static constexpr int VOXEL_SOUTH_SIDE_IDX = 3;
+	static constexpr int VOXEL_WEST_SIDE_IDX = 4;
+	static constexpr int VOXEL_DOWN_SIDE_IDX = 5;
+
+	// Compiled adjacency list, rules.get_mask(tile_id, side_constant) = mask of the allowed tile IDs
+	using AdjacencyRules = std::shared_ptr<const AdjacencyTable>;
+
+	static constexpr const char* SYMMETRY_TYPE_I = "I";
+	static constexpr const char* SYMMETRY_TYPE_L = "L";
+	static constexpr const char* SYMMETRY_TYPE_T = "T";
+	static constexpr const char* SYMMETRY_TYPE_X = "X";
+
+	struct TileData
+	{
+		string symmetry_type;
+		float weight;
+		// edge values indexed by side constant
+		vector<string> edges;
+		// name of the tile this one is a rotation of and its clockwise rotation in degrees, set by add_tile_rotations
+		string base_name;
+		int rotation = 0;
+	};
+
+	AdjacencyRules adjacency;
 
 	/**
-	 * @brief Constructs a TileSet by loading images and adjacency rules.
+	 * @brief Constructs a TileSet by loading the tiles and their adjacency rules.
+	 * Images are loaded separately by TileMapRenderer, the tile set doesn't depend on openFrameworks
 	 * @param xml_path Path to the XML file containing adjacency rules.
-	 * @param images_folder_path Path to the folder containing tile images.
 	 */
-	TileImages images;
-	AdjacencyRules adjacency;
-	
-	TileSet(const string& xml_path, const string& images_folder_path);
+	explicit TileSet(const string& xml_path);
+
+	/**
+	 * @brief Constructs a TileSet from its compiled cache. If the cache is missing or stale, the XML is loaded
+	 * and compiled as usual and the cache is written for the next start
+	 * @param cache_path Path of the TileSetCache file
+	 */
+	TileSet(const string& xml_path, const string& cache_path);
+
+	/**
+	 * @brief Constructs a TileSet from tiles defined in code, e.g. synthetic sets for benchmarks
+	 * @param tiles Maps tile name to its data, rotations are added according to the symmetry type
+	 * @param number_of_sides 4 for square grids, or 6 for hex and voxel grids, whose tiles aren't rotated
+	 * @param is_rotated False to use the tiles as defined, with their weights as given, e.g. the patterns of an
+	 * OverlappingModel which already include their rotations
+	 */
+	explicit TileSet(const unordered_map<string, TileData>& tiles, int number_of_sides = NUMBER_OF_SIDES, bool is_rotated = true);
 
-	float get_weight(const string& tile_name) const {return m_set_data.tiles.at(tile_name).weight;}
+	/**
+	 * @brief Returns the number of sides of each tile, and the number of edges of its TileData
+	 */
+	int get_number_of_sides() const {return m_number_of_sides;}
+
+	int get_tile_count() const {return static_cast<int>(m_tile_names.size());}
+	const string& get_name(const int tile_id) const {return m_tile_names[tile_id];}
+	const vector<string>& get_tile_names() const {return m_tile_names;}
+	int get_id(const string& tile_name) const {return m_tile_ids.at(tile_name);}
+	float get_weight(const int tile_id) const {return m_weights[tile_id];}
+
+	/**
+	 * @brief Returns the name of the unrotated tile, e.g. "corner" for "corner_90", which names the tile's image
+	 */
+	const string& get_base_name(const int tile_id) const {return m_base_names[tile_id];}
+	// Clockwise rotation of the tile's image in degrees, a multiple of 90
+	int get_rotation(const int tile_id) const {return m_rotations[tile_id];}
+	double get_weight_log_weight(const int tile_id) const {return m_weight_log_weights[tile_id];}
+
+	/**
+	 * @brief Returns the alias table over all tile IDs by weight, samples a cell that can still be any tile in O(1)
+	 */
+	const AliasTable& get_alias_table() const {return m_alias_table;}
+
+	/**
+	 * @brief Returns a domain with all of the set's tile IDs
+	 */
+	Domain get_full_domain() const {return Domain(get_tile_count(), true);}
+
+	/**
+	 * @brief Returns the atlas pixels stored in the cache this tile set was loaded from, if any
+	 */
+	std::optional<TileSetCache::AtlasPixels> get_cached_atlas() const;
+
+	/**
+	 * @brief Rewrites the cache with the atlas pixels, so the next start doesn't decode the images.
+	 * No-op unless the tile set was constructed with a cache path
+	 */
+	bool write_cached_atlas(const TileSetCache::AtlasPixels& atlas) const;
 
 	static int rotate_side(const int side_idx, const int degrees) {return (side_idx + degrees/90) % NUMBER_OF_SIDES;}
-	static int opposite_side(const int side_idx) {return rotate_side(side_idx, 180);}
+
+	/**
+	 * @brief Returns the side facing side_idx. Sides are numbered around the tile, so for any number of sides
+	 * the opposite one is half way around
+	 */
+	static int opposite_side(const int side_idx, const int number_of_sides = NUMBER_OF_SIDES) {return (side_idx + number_of_sides / 2) % number_of_sides;}
+
+	static bool is_supported_number_of_sides(const int number_of_sides) {return number_of_sides == NUMBER_OF_SIDES || number_of_sides == HEX_NUMBER_OF_SIDES;}
 
 private:
 	static constexpr float DEFAULT_WEIGHT = 1;
@@ -55,35 +152,53 @@ private:
 		{"top", TOP_SIDE_IDX}, {"right", RIGHT_SIDE_IDX}, {"bottom", BOTTOM_SIDE_IDX}, {"left", LEFT_SIDE_IDX}
 	};
 
-	static constexpr const char* SYMMETRY_TYPE_I = "I";
-	static constexpr const char* SYMMETRY_TYPE_L = "L";
-	static constexpr const char* SYMMETRY_TYPE_T = "T";
-	static constexpr const char* SYMMETRY_TYPE_X = "X";
+	// side names of sets with 6 sides, hex and voxel names can't be confused
+	inline static unordered_map<string, int> SIX_SIDES{
+		{"north_east", HEX_NORTH_EAST_SIDE_IDX}, {"east", HEX_EAST_SIDE_IDX}, {"south_east", HEX_SOUTH_EAST_SIDE_IDX},
+		{"south_west", HEX_SOUTH_WEST_SIDE_IDX}, {"west", HEX_WEST_SIDE_IDX}, {"north_west", HEX_NORTH_WEST_SIDE_IDX},
+		{"north", VOXEL_NORTH_SIDE_IDX}, {"up", VOXEL_UP_SIDE_IDX}, {"south", VOXEL_SOUTH_SIDE_IDX}, {"down", VOXEL_DOWN_SIDE_IDX}
+	};
 
 	inline static unordered_map<string, int> symmetry_type_to_rotations{
 				{SYMMETRY_TYPE_I, 2}, {SYMMETRY_TYPE_L, 4}, {SYMMETRY_TYPE_T, 4}, {SYMMETRY_TYPE_X, 1}
 	};
 
-	struct TileData
-	{
-		string symmetry_type;
-		float weight;
-		vector<string> edges;
-	};
-
 	struct SetData
 	{
 		unordered_map<string, TileData> tiles;
+		int number_of_sides = NUMBER_OF_SIDES;
+		// whether rotations are added according to the tiles' symmetry types
+		bool is_rotated = true;
 	};
 
 	SetData m_set_data;
+	int m_number_of_sides = NUMBER_OF_SIDES;
+
+	// Dense tile IDs of the rotated tiles (e.g. corner_90), ordered by name
+	vector<string> m_tile_names;
+	unordered_map<string, int> m_tile_ids;
+	vector<float> m_weights;
+	vector<string> m_base_names;
+	vector<int> m_rotations;
+	// w*log(w) per tile ID, precomputed for the generator's incremental entropy
+	vector<double> m_weight_log_weights;
+	AliasTable m_alias_table;
+
+	string m_cache_path;
+	uint64_t m_source_hash = 0;
+	// the mapped cache when loaded from one, also owns the adjacency rules' buffers
+	std::shared_ptr<const TileSetCache> m_cache;
+
+	void load(const SetData& set_data);
+	void assign_tile_ids();
+	void load_cache(const std::shared_ptr<const TileSetCache>& cache);
 
 	static SetData parse_set_data(const string& xml_path);
 	static SetData add_rotated_tiles(const SetData& set_data);
 
-	static TileImages load_set_images(const string& images_folder_path);
-	static AdjacencyRules load_adjacency_rules(const SetData& set_data);
-	static void print_rules(const AdjacencyRules& rules);
+	AdjacencyRules load_adjacency_rules() const;
+	vector<int> intern_edges(int& edge_count) const;
+	void print_rules(const AdjacencyRules& rules) const;
 
 	static vector<string> rotate_edges_map(const vector<string>& edges_map, int rotate_by);
 	static void add_tile_rotations(SetData& set_data, const pair<string, TileData>& tile_data);
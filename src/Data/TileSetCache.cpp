@@ -0,0 +1,297 @@
+#include "TileSetCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "AdjacencyTable.h"
+#include "TileSet.h"
+
+namespace
+{
+	constexpr size_t SECTION_ALIGNMENT = 8;
+
+	uint64_t fnv1a(uint64_t hash, const char* data, const size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= static_cast<uint8_t>(data[i]);
+			hash *= 0x100000001B3;
+		}
+
+		return hash;
+	}
+
+	uint64_t hash_file(const uint64_t hash, const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		const vector<char> content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+		return fnv1a(hash, content.data(), content.size());
+	}
+
+	// Appends sections to a byte buffer
+	class BlobWriter
+	{
+	public:
+		template <typename T>
+		void write(const T* values, const size_t count)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(values);
+			m_bytes.insert(m_bytes.end(), bytes, bytes + count * sizeof(T));
+		}
+
+		template <typename T>
+		void write(const T& value) { write(&value, 1); }
+
+		void write_string(const string& value)
+		{
+			write(static_cast<uint32_t>(value.size()));
+			write(value.data(), value.size());
+		}
+
+		void align() { m_bytes.resize((m_bytes.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT, 0); }
+
+		const vector<uint8_t>& get_bytes() const { return m_bytes; }
+
+	private:
+		vector<uint8_t> m_bytes;
+	};
+
+	// Hands out typed views into a mapped blob, nullptr once a section would run past its end
+	class BlobReader
+	{
+	public:
+		BlobReader(const uint8_t* data, const size_t size) : m_data(data), m_size(size) {}
+
+		template <typename T>
+		const T* read(const size_t count)
+		{
+			if (m_offset > m_size || count > (m_size - m_offset) / sizeof(T))
+			{
+				m_offset = m_size + 1;
+				return nullptr;
+			}
+
+			const T* values = reinterpret_cast<const T*>(m_data + m_offset);
+			m_offset += count * sizeof(T);
+			return values;
+		}
+
+		bool read_string(std::string_view& value)
+		{
+			const uint32_t* length = read<uint32_t>(1);
+			const char* chars = length != nullptr ? read<char>(*length) : nullptr;
+			if (chars == nullptr)
+			{
+				return false;
+			}
+
+			value = std::string_view(chars, *length);
+			return true;
+		}
+
+		void align() { m_offset = (m_offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+	};
+}
+
+uint64_t TileSetCache::hash_sources(const string& xml_path)
+{
+	uint64_t hash = hash_file(0xCBF29CE484222325, xml_path);
+
+	const std::filesystem::path images_folder_path = std::filesystem::path(xml_path).replace_extension();
+	if (!std::filesystem::is_directory(images_folder_path))
+	{
+		return hash;
+	}
+
+	// sort, directory iteration order is unspecified
+	vector<std::filesystem::path> image_paths;
+	for (const auto& file : std::filesystem::directory_iterator(images_folder_path))
+	{
+		if (file.is_regular_file())
+		{
+			image_paths.push_back(file.path());
+		}
+	}
+	std::ranges::sort(image_paths);
+
+	for (const std::filesystem::path& image_path : image_paths)
+	{
+		const string file_name = image_path.filename().string();
+		hash = fnv1a(hash, file_name.data(), file_name.size());
+		hash = hash_file(hash, image_path);
+	}
+
+	return hash;
+}
+
+bool TileSetCache::write(const string& path, const uint64_t source_hash, const TileSet& tile_set, const AtlasPixels* atlas)
+{
+	const int tile_count = tile_set.get_tile_count();
+	const AdjacencyTable& adjacency = *tile_set.adjacency;
+	const int entry_count = tile_count * tile_set.get_number_of_sides();
+
+	BlobWriter blob;
+	blob.write(MAGIC);
+	blob.write(VERSION);
+	blob.write(source_hash);
+	blob.write(static_cast<int32_t>(tile_count));
+	blob.write(static_cast<int32_t>(tile_set.get_number_of_sides()));
+	blob.write(static_cast<int32_t>(adjacency.get_mask_count()));
+	blob.write(static_cast<int32_t>(atlas != nullptr));
+
+	for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+	{
+		blob.write_string(tile_set.get_name(tile_id));
+		blob.write_string(tile_set.get_base_name(tile_id));
+	}
+	blob.align();
+
+	vector<int32_t> rotations(tile_count);
+	vector<float> weights(tile_count);
+	vector<double> weight_log_weights(tile_count);
+	for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+	{
+		rotations[tile_id] = tile_set.get_rotation(tile_id);
+		weights[tile_id] = tile_set.get_weight(tile_id);
+		weight_log_weights[tile_id] = tile_set.get_weight_log_weight(tile_id);
+	}
+
+	blob.write(rotations.data(), rotations.size());
+	blob.align();
+	blob.write(weights.data(), weights.size());
+	blob.align();
+	blob.write(weight_log_weights.data(), weight_log_weights.size());
+	blob.write(adjacency.get_mask_index_data(), entry_count);
+	blob.align();
+	blob.write(adjacency.get_support_count_data(), entry_count);
+	blob.align();
+	blob.write(adjacency.get_mask_data(), static_cast<size_t>(adjacency.get_mask_count()) * adjacency.get_word_count());
+
+	if (atlas != nullptr)
+	{
+		const int32_t atlas_header[]{atlas->width, atlas->height, atlas->columns, atlas->slot_width, atlas->slot_height};
+		blob.write(atlas_header, std::size(atlas_header));
+		blob.align();
+		blob.write(atlas->rgba, static_cast<size_t>(atlas->width) * atlas->height * 4);
+	}
+
+	// write next to the destination and rename, so readers never map a partially written cache
+	const string temp_path = path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(blob.get_bytes().data()), static_cast<std::streamsize>(blob.get_bytes().size()));
+		if (!file)
+		{
+			std::cerr << "Failed to write tile set cache: " << temp_path << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, path, error);
+	if (error)
+	{
+		std::cerr << "Failed to write tile set cache: " << path << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const TileSetCache> TileSetCache::open(const string& path, const uint64_t source_hash)
+{
+	std::shared_ptr<TileSetCache> cache(new TileSetCache(path));
+	if (!cache->m_file.is_open() || !cache->parse(source_hash))
+	{
+		return nullptr;
+	}
+
+	return cache;
+}
+
+bool TileSetCache::parse(const uint64_t source_hash)
+{
+	BlobReader blob(m_file.data(), m_file.size());
+
+	const uint32_t* magic = blob.read<uint32_t>(1);
+	const uint32_t* version = blob.read<uint32_t>(1);
+	const uint64_t* hash = blob.read<uint64_t>(1);
+	const int32_t* counts = blob.read<int32_t>(4);
+	if (counts == nullptr || *magic != MAGIC || *version != VERSION || *hash != source_hash)
+	{
+		return false;
+	}
+
+	m_tile_count = counts[0];
+	m_number_of_sides = counts[1];
+	m_mask_count = counts[2];
+	const bool has_atlas = counts[3] != 0;
+	if (m_tile_count < 0 || m_mask_count < 0 || !TileSet::is_supported_number_of_sides(m_number_of_sides))
+	{
+		return false;
+	}
+
+	m_names.resize(m_tile_count);
+	m_base_names.resize(m_tile_count);
+	for (int tile_id = 0; tile_id < m_tile_count; ++tile_id)
+	{
+		if (!blob.read_string(m_names[tile_id]) || !blob.read_string(m_base_names[tile_id]))
+		{
+			return false;
+		}
+	}
+	blob.align();
+
+	const size_t entry_count = static_cast<size_t>(m_tile_count) * m_number_of_sides;
+	m_rotations = blob.read<int32_t>(m_tile_count);
+	blob.align();
+	m_weights = blob.read<float>(m_tile_count);
+	blob.align();
+	m_weight_log_weights = blob.read<double>(m_tile_count);
+	m_mask_indices = blob.read<int32_t>(entry_count);
+	blob.align();
+	m_support_counts = blob.read<int32_t>(entry_count);
+	blob.align();
+	m_mask_words = blob.read<uint64_t>(static_cast<size_t>(m_mask_count) * Domain::words_for(m_tile_count));
+	if (m_mask_words == nullptr)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < entry_count; ++i)
+	{
+		if (m_mask_indices[i] < 0 || m_mask_indices[i] >= m_mask_count)
+		{
+			return false;
+		}
+	}
+
+	if (has_atlas)
+	{
+		const int32_t* atlas_header = blob.read<int32_t>(5);
+		blob.align();
+		if (atlas_header == nullptr || atlas_header[0] < 0 || atlas_header[1] < 0)
+		{
+			return false;
+		}
+
+		AtlasPixels atlas{atlas_header[0], atlas_header[1], atlas_header[2], atlas_header[3], atlas_header[4]};
+		atlas.rgba = blob.read<uint8_t>(static_cast<size_t>(atlas.width) * atlas.height * 4);
+		if (atlas.rgba == nullptr)
+		{
+			return false;
+		}
+		m_atlas = atlas;
+	}
+
+	return true;
+}
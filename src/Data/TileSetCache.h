@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Util/MappedFile.h"
+
+using std::string;
+using std::vector;
+
+class TileSet;
+
+/**
+ * @class TileSetCache
+ * @brief Versioned binary blob of a compiled TileSet: tile names, rotations, normalized weights, w*log(w),
+ * the adjacency masks and optionally the decoded atlas pixels. The blob is memory mapped and its adjacency
+ * buffers are used in place, so loading skips the XML parsing, rotation expansion and rule compilation.
+ * A cache is only used if its source hash matches the current content of the XML and the tile images.
+ *
+ * Layout, native byte order, every section 8 byte aligned:
+ * header (magic "WFCT", version, source hash, tile count, sides, mask count, has atlas),
+ * names and base names (uint32 length + chars per tile), int32 rotations, float weights, double w*log(w),
+ * int32 mask indices and support counts (tile * sides + side), uint64 mask words,
+ * optionally the atlas (int32 width, height, columns, slot width, slot height, RGBA pixels)
+ */
+class TileSetCache
+{
+public:
+	static constexpr uint32_t VERSION = 2;
+
+	// Pixels of a TileAtlas, slot i holds the image of the i-th distinct base name in tile ID order
+	struct AtlasPixels
+	{
+		int width = 0;
+		int height = 0;
+		int columns = 0;
+		int slot_width = 0;
+		int slot_height = 0;
+		// width * height RGBA pixels, row-major
+		const uint8_t* rgba = nullptr;
+	};
+
+	/**
+	 * @brief Returns a hash of the XML's content and of every file in the tile images folder next to it,
+	 * which is the XML path without its extension, e.g. Tilesets/Knots for Tilesets/Knots.xml
+	 */
+	static uint64_t hash_sources(const string& xml_path);
+
+	/**
+	 * @brief Writes the tile set's cache, replacing an existing file atomically
+	 * @param atlas Optional atlas pixels to store with it
+	 */
+	static bool write(const string& path, uint64_t source_hash, const TileSet& tile_set, const AtlasPixels* atlas = nullptr);
+
+	/**
+	 * @brief Maps the cache, returns nullptr if it is missing, malformed, of another version or built from other sources
+	 */
+	static std::shared_ptr<const TileSetCache> open(const string& path, uint64_t source_hash);
+
+	int get_tile_count() const { return m_tile_count; }
+	int get_number_of_sides() const { return m_number_of_sides; }
+	int get_mask_count() const { return m_mask_count; }
+
+	std::string_view get_name(const int tile_id) const { return m_names[tile_id]; }
+	std::string_view get_base_name(const int tile_id) const { return m_base_names[tile_id]; }
+	int get_rotation(const int tile_id) const { return m_rotations[tile_id]; }
+	float get_weight(const int tile_id) const { return m_weights[tile_id]; }
+	double get_weight_log_weight(const int tile_id) const { return m_weight_log_weights[tile_id]; }
+
+	const uint64_t* get_mask_words() const { return m_mask_words; }
+	const int32_t* get_mask_indices() const { return m_mask_indices; }
+	const int32_t* get_support_counts() const { return m_support_counts; }
+
+	const std::optional<AtlasPixels>& get_atlas() const { return m_atlas; }
+
+private:
+	static constexpr uint32_t MAGIC = 0x54434657; // "WFCT" read as a little-endian uint32_t
+
+	MappedFile m_file;
+
+	int m_tile_count = 0;
+	int m_number_of_sides = 0;
+	int m_mask_count = 0;
+	vector<std::string_view> m_names;
+	vector<std::string_view> m_base_names;
+	const int32_t* m_rotations = nullptr;
+	const float* m_weights = nullptr;
+	const double* m_weight_log_weights = nullptr;
+	const int32_t* m_mask_indices = nullptr;
+	const int32_t* m_support_counts = nullptr;
+	const uint64_t* m_mask_words = nullptr;
+	std::optional<AtlasPixels> m_atlas;
+
+	explicit TileSetCache(const string& path) : m_file(path) {}
+
+	bool parse(uint64_t source_hash);
+};
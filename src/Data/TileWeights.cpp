@@ -0,0 +1,39 @@
+#include "TileWeights.h"
+
+#include <bit>
+
+TileWeights::TileWeights(const TileSet& tile_set)
+	: m_word_count{Domain::words_for(tile_set.get_tile_count())}
+{
+	m_weights.assign(static_cast<size_t>(m_word_count) * Domain::BITS_PER_WORD, 0);
+	m_weight_log_weights.assign(m_weights.size(), 0);
+
+	for (int tile_id = 0; tile_id < tile_set.get_tile_count(); ++tile_id)
+	{
+		m_weights[tile_id] = tile_set.get_weight(tile_id);
+		m_weight_log_weights[tile_id] = tile_set.get_weight_log_weight(tile_id);
+	}
+}
+
+int TileWeights::sample(const uint64_t* words, const double random_value) const
+{
+	double cumulative = 0;
+	int selected_tile = -1;
+
+	for (int i = 0; i < m_word_count; ++i)
+	{
+		uint64_t word = words[i];
+		while (word != 0)
+		{
+			selected_tile = i * Domain::BITS_PER_WORD + std::countr_zero(word);
+			cumulative += m_weights[selected_tile];
+			if (random_value < cumulative)
+			{
+				return selected_tile;
+			}
+			word &= word - 1;
+		}
+	}
+
+	return selected_tile;
+}
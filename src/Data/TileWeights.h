@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TileSet.h"
+#include "Util/DomainKernels.h"
+
+using std::vector;
+
+/**
+ * @class TileWeights
+ * @brief A tile set's weights and w*log(w) as doubles, zero padded to whole domain words for the DomainKernels.
+ * Solvers that keep plain domain words compute entropies and sample tiles through it, so they all do it the same way
+ */
+class TileWeights
+{
+public:
+	explicit TileWeights(const TileSet& tile_set);
+
+	int get_word_count() const { return m_word_count; }
+
+	/**
+	 * @brief Shannon entropy of the domain's tiles, see DomainKernels::entropy
+	 */
+	double get_entropy(const uint64_t* words) const
+	{
+		return DomainKernels::entropy(words, m_word_count, m_weights.data(), m_weight_log_weights.data());
+	}
+
+	double get_weight_sum(const uint64_t* words) const
+	{
+		return DomainKernels::weighted_popcount(words, m_word_count, m_weights.data(), m_weight_log_weights.data()).weight_sum;
+	}
+
+	/**
+	 * @brief Walks the domain's tiles in tile ID order until their cumulative weight passes random_value
+	 * @param random_value In [0, the domain's weight sum)
+	 * @return The tile the walk stopped at. The last tile if rounding of the weight sum left random_value past the walk
+	 */
+	int sample(const uint64_t* words, double random_value) const;
+
+private:
+	const int m_word_count;
+	vector<double> m_weights;
+	vector<double> m_weight_log_weights;
+};
@@ -0,0 +1,80 @@
+#include "BatchGenerator.h"
+
+BatchGenerator::BatchGenerator(const TileSet& tile_set, const int thread_count)
+	: m_tile_set{tile_set}, m_thread_pool{thread_count}
+{
+}
+
+void BatchGenerator::generate(const Settings& settings, const ResultSink& sink)
+{
+	m_generators.clear();
+	m_solvers.clear();
+	for (int i = 0; i < m_thread_pool.get_thread_count(); ++i)
+	{
+		if (settings.is_specialized)
+		{
+			m_solvers.push_back(TileMapSolver::create(m_tile_set, settings.grid_type));
+			continue;
+		}
+
+		m_generators.push_back(std::make_unique<TileMapGenerator>(m_tile_set, settings.propagator));
+		m_generators.back()->set_backtracking(settings.backtracking);
+		m_generators.back()->set_stats_mode(settings.stats_mode);
+	}
+
+	for (int map_idx = 0; map_idx < settings.count; ++map_idx)
+	{
+		m_thread_pool.submit([this, &settings, &sink, map_idx]
+		{
+			const int worker_index = m_thread_pool.get_current_worker_index();
+			sink(settings.is_specialized ? generate_map(*m_solvers[worker_index], settings, map_idx) : generate_map(*m_generators[worker_index], settings, map_idx));
+		});
+	}
+
+	m_thread_pool.wait_idle();
+}
+
+BatchGenerator::MapResult BatchGenerator::generate_map(TileMapGenerator& generator, const Settings& settings, const int map_idx) const
+{
+	MapResult map_result{map_idx, settings.base_seed + map_idx, 0, {}, {}, {}};
+
+	// retries continue the map's random sequence, so the result only depends on the map's seed
+	generator.set_seed(map_result.seed);
+	while (map_result.attempts < settings.max_attempts)
+	{
+		map_result.attempts++;
+		map_result.result = generator.generate_tile_map(settings.width, settings.height);
+
+		if (map_result.result.status == TileMapGenerator::GenerationStatus::Finished)
+		{
+			break;
+		}
+	}
+
+	map_result.tile_ids = generator.get_collapsed_ids();
+	if (generator.get_stats().is_enabled())
+	{
+		map_result.stats = generator.get_stats();
+	}
+	return map_result;
+}
+
+BatchGenerator::MapResult BatchGenerator::generate_map(TileMapSolver& solver, const Settings& settings, const int map_idx) const
+{
+	MapResult map_result{map_idx, settings.base_seed + map_idx, 0, {}, {}, {}};
+
+	solver.set_seed(map_result.seed);
+	while (map_result.attempts < settings.max_attempts)
+	{
+		map_result.attempts++;
+		map_result.result = solver.generate_tile_map(settings.width, settings.height, settings.depth);
+
+		if (map_result.result.status == TileMapGenerator::GenerationStatus::Finished)
+		{
+			break;
+		}
+	}
+
+	map_result.tile_ids = solver.get_collapsed_ids();
+	return map_result;
+}
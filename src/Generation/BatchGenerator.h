@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Data/TileSet.h"
+#include "Generation/GenerationStats.h"
+#include "Generation/TileMapSolver.h"
+#include "TileMapGenerator.h"
+#include "Util/ThreadPool.h"
+
+using std::vector;
+
+/**
+ * @class BatchGenerator
+ * @brief Generates many independent maps from one shared, immutable TileSet on a work-stealing thread pool.
+ * Every worker owns its TileMapGenerator, so no solver state is shared between threads.
+ */
+class BatchGenerator
+{
+public:
+	struct Settings {
+		int width = 64;
+		int height = 64;
+		int count = 1;
+		// map i is generated with seed base_seed + i, so results don't depend on the thread count
+		uint64_t base_seed = 0;
+		// generations to try per map before reporting a contradiction
+		int max_attempts = 10;
+		TileMapGenerator::PropagatorType propagator = TileMapGenerator::PropagatorType::DomainScan;
+		TileMapGenerator::BacktrackingSettings backtracking;
+		GenerationStats::Mode stats_mode = GenerationStats::Mode::Disabled;
+		// generate with the TileMapSolver specialized for the tile set's domain width instead of TileMapGenerator,
+		// the propagator, backtracking and stats settings don't apply then
+		bool is_specialized = false;
+		// specialized only, the grid has to match the tile set's number of sides
+		TileMapSolver::GridType grid_type = TileMapSolver::GridType::Square;
+		// layers of a voxel grid
+		int depth = 1;
+	};
+
+	struct MapResult {
+		int map_idx;
+		uint64_t seed;
+		int attempts;
+		TileMapGenerator::GenerationResult result;
+		// row-major collapsed tile IDs, see TileMapGenerator::get_collapsed_ids
+		vector<int> tile_ids;
+		// instrumentation of the last attempt, empty unless settings.stats_mode enables it
+		GenerationStats stats;
+	};
+
+	/**
+	 * @brief Receives each map as soon as it finishes. Called concurrently from the worker threads, in no particular order
+	 */
+	using ResultSink = std::function<void(MapResult&&)>;
+
+	/**
+	 * @param tile_set Shared by all workers, must outlive the BatchGenerator
+	 * @param thread_count Number of worker threads, defaults to the number of hardware threads
+	 */
+	explicit BatchGenerator(const TileSet& tile_set, int thread_count = static_cast<int>(std::thread::hardware_concurrency()));
+
+	int get_thread_count() const { return m_thread_pool.get_thread_count(); }
+
+	/**
+	 * @brief Generates settings.count maps and blocks until all of them were passed to the sink
+	 */
+	void generate(const Settings& settings, const ResultSink& sink);
+
+private:
+	const TileSet& m_tile_set;
+	ThreadPool m_thread_pool;
+	// m_generators[worker_index], created for each batch since the propagator is a per batch setting
+	vector<std::unique_ptr<TileMapGenerator>> m_generators;
+	// m_solvers[worker_index], only created for specialized batches
+	vector<std::unique_ptr<TileMapSolver>> m_solvers;
+
+	MapResult generate_map(TileMapGenerator& generator, const Settings& settings, int map_idx) const;
+	MapResult generate_map(TileMapSolver& solver, const Settings& settings, int map_idx) const;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Data/Domain.h"
+
+/**
+ * @brief Domain width policies of BasicTileMapGenerator. A fixed width makes word_count() a compile-time
+ * constant, so loops over a domain's words unroll into a few AND/OR/popcount instructions
+ */
+template <int WORD_COUNT>
+struct FixedDomainWords
+{
+	static_assert(WORD_COUNT > 0);
+
+	static constexpr int MAX_TILES = WORD_COUNT * Domain::BITS_PER_WORD;
+
+	explicit FixedDomainWords([[maybe_unused]] const int word_count) {}
+
+	static constexpr int word_count() { return WORD_COUNT; }
+};
+
+// Any number of words, for tile sets wider than the largest fixed instantiation
+struct DynamicDomainWords
+{
+	explicit DynamicDomainWords(const int word_count) : m_word_count(word_count) {}
+
+	int word_count() const { return m_word_count; }
+
+private:
+	int m_word_count;
+};
@@ -0,0 +1,98 @@
+#include "GenerationStats.h"
+
+void GenerationStats::reset()
+{
+	m_start_time = Clock::now();
+	m_current_step = StepStats{};
+	m_totals = Totals{};
+	m_steps.clear();
+}
+
+// Starts recording a step, returns the start time of its first phase
+GenerationStats::Clock::time_point GenerationStats::begin_step()
+{
+	const Clock::time_point now = Clock::now();
+	m_current_step = StepStats{};
+	m_current_step.start_seconds = std::chrono::duration<double>(now - m_start_time).count();
+
+	return now;
+}
+
+void GenerationStats::end_step()
+{
+	m_totals.steps++;
+	m_totals.selection_seconds += m_current_step.selection_seconds;
+	m_totals.collapse_seconds += m_current_step.collapse_seconds;
+	m_totals.propagation_seconds += m_current_step.propagation_seconds;
+	m_totals.tiles_banned += m_current_step.tiles_banned;
+	m_totals.cells_touched += m_current_step.cells_touched;
+	m_totals.queue_high_water = std::max(m_totals.queue_high_water, m_current_step.queue_high_water);
+	m_totals.contradictions += m_current_step.is_contradiction ? 1 : 0;
+
+	if (m_mode == Mode::Trace)
+	{
+		m_steps.push_back(m_current_step);
+	}
+}
+
+void GenerationStats::write_summary_json(std::ostream& stream) const
+{
+	stream << "{\"steps\": " << m_totals.steps
+		   << ", \"selection_seconds\": " << m_totals.selection_seconds
+		   << ", \"collapse_seconds\": " << m_totals.collapse_seconds
+		   << ", \"propagation_seconds\": " << m_totals.propagation_seconds
+		   << ", \"tiles_banned\": " << m_totals.tiles_banned
+		   << ", \"cells_touched\": " << m_totals.cells_touched
+		   << ", \"queue_high_water\": " << m_totals.queue_high_water
+		   << ", \"contradictions\": " << m_totals.contradictions << "}";
+}
+
+void GenerationStats::write_chrome_trace(std::ostream& stream) const
+{
+	constexpr double MICROSECONDS = 1e6;
+
+	bool is_first = true;
+	auto write_event = [&](const char* name, const char* phase, const double start_seconds, const double duration_seconds)
+	{
+		stream << (is_first ? "\n" : ",\n") << "{\"name\": \"" << name << "\", \"ph\": \"" << phase << "\", \"pid\": 1, \"tid\": 1, \"ts\": "
+			   << start_seconds * MICROSECONDS;
+		if (duration_seconds >= 0)
+		{
+			stream << ", \"dur\": " << duration_seconds * MICROSECONDS;
+		}
+		is_first = false;
+	};
+
+	stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+	for (int i = 0; i < static_cast<int>(m_steps.size()); ++i)
+	{
+		const StepStats& step = m_steps[i];
+		const double duration = step.selection_seconds + step.collapse_seconds + step.propagation_seconds;
+
+		write_event("step", "X", step.start_seconds, duration);
+		stream << ", \"args\": {\"step\": " << i << ", \"cell\": " << step.collapsed_idx << "}}";
+
+		double phase_start = step.start_seconds;
+		write_event("selection", "X", phase_start, step.selection_seconds);
+		stream << "}";
+		phase_start += step.selection_seconds;
+		write_event("collapse", "X", phase_start, step.collapse_seconds);
+		stream << "}";
+		phase_start += step.collapse_seconds;
+		write_event("propagation", "X", phase_start, step.propagation_seconds);
+		stream << "}";
+
+		write_event("counters", "C", step.start_seconds, -1);
+		stream << ", \"args\": {\"tiles_banned\": " << step.tiles_banned << ", \"cells_touched\": " << step.cells_touched
+			   << ", \"queue_high_water\": " << step.queue_high_water << "}}";
+
+		if (step.is_contradiction)
+		{
+			write_event("contradiction", "i", phase_start + step.propagation_seconds, -1);
+			stream << ", \"s\": \"t\", \"args\": {\"step\": " << i << "}}";
+		}
+	}
+
+	stream << "\n]}\n";
+}
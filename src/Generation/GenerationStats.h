@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Build with -DWFC_ENABLE_STATS=0 to compile the instrumentation out of the generator entirely
+#ifndef WFC_ENABLE_STATS
+#define WFC_ENABLE_STATS 1
+#endif
+
+using std::vector;
+
+/**
+ * @class GenerationStats
+ * @brief Optional per-step instrumentation of TileMapGenerator: phase times, propagation queue high-water mark,
+ * tiles banned, cells touched and contradictions. Aggregated over a generation, and in Trace mode also kept
+ * per step so the run can be exported as a Chrome trace-event timeline (chrome://tracing, Perfetto).
+ * While disabled every hook is a single branch, with WFC_ENABLE_STATS=0 the hooks are constant false and removed.
+ */
+class GenerationStats
+{
+public:
+	static constexpr bool IS_COMPILED = WFC_ENABLE_STATS != 0;
+
+	enum class Mode { Disabled, Aggregate, Trace };
+
+	struct StepStats {
+		// seconds since the generation started
+		double start_seconds = 0;
+		double selection_seconds = 0;
+		double collapse_seconds = 0;
+		double propagation_seconds = 0;
+		int collapsed_idx = -1;
+		int tiles_banned = 0;
+		// distinct cells whose domain changed
+		int cells_touched = 0;
+		// most pending entries of the propagation queue, the update queue or the AC-4 ban stack
+		int queue_high_water = 0;
+		bool is_contradiction = false;
+	};
+
+	struct Totals {
+		int steps = 0;
+		double selection_seconds = 0;
+		double collapse_seconds = 0;
+		double propagation_seconds = 0;
+		int64_t tiles_banned = 0;
+		int64_t cells_touched = 0;
+		int queue_high_water = 0;
+		int contradictions = 0;
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Falls back to Disabled when the instrumentation is compiled out
+	 */
+	void set_mode(const Mode mode) { m_mode = IS_COMPILED ? mode : Mode::Disabled; }
+	Mode get_mode() const { return m_mode; }
+	bool is_enabled() const { return IS_COMPILED && m_mode != Mode::Disabled; }
+
+	/**
+	 * @brief Clears the totals and recorded steps and restarts the timeline, called by init_tile_map
+	 */
+	void reset();
+
+	// hooks called by the generator, only while is_enabled()
+	Clock::time_point begin_step();
+	StepStats& get_current_step() { return m_current_step; }
+	void on_tile_banned() { m_current_step.tiles_banned++; }
+	void on_queue_size(const size_t size) { m_current_step.queue_high_water = std::max(m_current_step.queue_high_water, static_cast<int>(size)); }
+	void end_step();
+
+	const Totals& get_totals() const { return m_totals; }
+
+	// recorded steps, only filled in Trace mode
+	const vector<StepStats>& get_steps() const { return m_steps; }
+
+	/**
+	 * @brief Writes the totals as a JSON object
+	 */
+	void write_summary_json(std::ostream& stream) const;
+
+	/**
+	 * @brief Writes the recorded steps in the Chrome trace-event format: one complete event per phase, nested in
+	 * one per step, counter events for the per-step counters and an instant event for every contradiction
+	 */
+	void write_chrome_trace(std::ostream& stream) const;
+
+private:
+	Mode m_mode = Mode::Disabled;
+	Clock::time_point m_start_time;
+	StepStats m_current_step;
+	Totals m_totals;
+	vector<StepStats> m_steps;
+};
@@ -0,0 +1,254 @@
+#include "GenerationWorker.h"
+
+#include <algorithm>
+
+GenerationWorker::GenerationWorker(const TileSet& tile_set, const Settings& settings)
+	: m_settings{settings}, m_generator{tile_set, settings.propagator}, m_steps_per_second{settings.steps_per_second}
+{
+	m_generator.set_backtracking(settings.backtracking);
+
+	// the first map is initialized on the worker thread as well
+	m_is_restart_requested = true;
+	m_thread = std::thread(&GenerationWorker::run, this);
+}
+
+GenerationWorker::~GenerationWorker()
+{
+	{
+		std::lock_guard lock(m_command_mutex);
+		m_is_stop_requested = true;
+	}
+	m_command_condition.notify_one();
+
+	m_thread.join();
+}
+
+void GenerationWorker::set_running(const bool is_running)
+{
+	{
+		std::lock_guard lock(m_command_mutex);
+		m_is_running = is_running;
+	}
+	m_command_condition.notify_one();
+}
+
+void GenerationWorker::set_steps_per_second(const double steps_per_second)
+{
+	{
+		std::lock_guard lock(m_command_mutex);
+		m_steps_per_second = steps_per_second;
+	}
+	m_command_condition.notify_one();
+}
+
+void GenerationWorker::request_restart()
+{
+	{
+		std::lock_guard lock(m_command_mutex);
+		m_is_restart_requested = true;
+	}
+	m_command_condition.notify_one();
+}
+
+const GenerationWorker::MapSnapshot& GenerationWorker::acquire_snapshot()
+{
+	m_snapshots.update();
+	return m_snapshots.get_front();
+}
+
+// Worker thread: sleeps while there is nothing to do, otherwise handles commands and generates in short chunks
+void GenerationWorker::run()
+{
+	double step_credit = 0;
+	Clock::time_point last_time = Clock::now();
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(m_command_mutex);
+			m_command_condition.wait(lock, [this] { return !is_idle(); });
+		}
+
+		if (m_is_stop_requested)
+		{
+			return;
+		}
+
+		if (m_is_restart_requested.exchange(false))
+		{
+			m_generator.init_tile_map(m_settings.width, m_settings.height);
+			step_credit = 0;
+			last_time = Clock::now();
+			publish();
+			continue;
+		}
+
+		if (!run_steps(step_credit, last_time))
+		{
+			continue;
+		}
+
+		if (m_generator.get_result().status == TileMapGenerator::GenerationStatus::Contradiction)
+		{
+			// backtracking, if enabled, already gave up on this map
+			m_contradiction_restarts++;
+			m_generator.init_tile_map(m_settings.width, m_settings.height);
+		}
+
+		publish();
+	}
+}
+
+/**
+ * Runs one chunk of steps: for PUBLISH_INTERVAL at full speed, otherwise the steps that are due at the configured rate.
+ * Returns false if no step was due, after sleeping until the next one is
+ */
+bool GenerationWorker::run_steps(double& step_credit, Clock::time_point& last_time)
+{
+	// steps missed while paused or starved aren't made up for beyond this
+	constexpr double MAX_CATCH_UP_SECONDS = 0.1;
+
+	const double steps_per_second = m_steps_per_second;
+	const Clock::time_point now = Clock::now();
+	const double elapsed_seconds = std::min(std::chrono::duration<double>(now - last_time).count(), MAX_CATCH_UP_SECONDS);
+	last_time = now;
+
+	if (steps_per_second <= 0)
+	{
+		step_credit = 0;
+		m_generator.generate_for(PUBLISH_INTERVAL);
+		return true;
+	}
+
+	step_credit += elapsed_seconds * steps_per_second;
+	const int steps = static_cast<int>(step_credit);
+	if (steps == 0)
+	{
+		// a command wakes the worker before the next step is due
+		const std::chrono::duration<double> wait_time((1 - step_credit) / steps_per_second);
+		std::unique_lock lock(m_command_mutex);
+		m_command_condition.wait_for(lock, wait_time, [this] { return m_is_stop_requested || m_is_restart_requested; });
+		return false;
+	}
+
+	step_credit -= steps;
+	m_generator.generate_steps(steps);
+	return true;
+}
+
+// Worker thread: brings the back buffer up to date and hands it to the reader
+void GenerationWorker::publish()
+{
+	const bool is_fully_dirty = m_generator.drain_dirty_cells(m_drained_cells);
+
+	// every buffer has to take over these cells the next time it's written
+	for (int buffer_idx = 0; buffer_idx < BUFFER_COUNT; ++buffer_idx)
+	{
+		if (is_fully_dirty)
+		{
+			m_is_pending_full[buffer_idx] = true;
+			continue;
+		}
+
+		if (m_is_pending_full[buffer_idx])
+		{
+			continue;
+		}
+
+		for (const int idx : m_drained_cells)
+		{
+			if (!m_is_pending[buffer_idx][idx])
+			{
+				m_is_pending[buffer_idx][idx] = true;
+				m_pending_cells[buffer_idx].push_back(idx);
+			}
+		}
+	}
+
+	update_unread_cells(is_fully_dirty);
+
+	MapSnapshot& snapshot = m_snapshots.get_back();
+	update_back_buffer(snapshot, m_snapshots.get_back_index());
+
+	snapshot.sequence = ++m_sequence;
+	snapshot.width = m_generator.get_width();
+	snapshot.height = m_generator.get_height();
+	snapshot.dirty_cells = m_unread_cells;
+	snapshot.dirty_base_sequence = m_unread_base_sequence;
+	snapshot.is_fully_dirty = m_is_unread_fully_dirty;
+	snapshot.result = m_generator.get_result();
+	snapshot.remaining_cells = m_generator.get_remaining_cells();
+	snapshot.contradiction_restarts = m_contradiction_restarts;
+
+	m_snapshots.publish();
+}
+
+/**
+ * Collects the dirty cells since the last snapshot the reader took. While the last published snapshot is unread it
+ * will be skipped, so the next one has to carry its dirty cells too
+ */
+void GenerationWorker::update_unread_cells(const bool is_fully_dirty)
+{
+	if (!m_snapshots.is_published_unread())
+	{
+		for (const int idx : m_unread_cells)
+		{
+			m_is_unread[idx] = false;
+		}
+		m_unread_cells.clear();
+		m_is_unread_fully_dirty = false;
+		m_unread_base_sequence = m_sequence;
+	}
+
+	if (is_fully_dirty || m_is_unread_fully_dirty)
+	{
+		m_unread_cells.clear();
+		m_is_unread.assign(m_generator.get_cell_count(), false);
+		m_is_unread_fully_dirty = true;
+		return;
+	}
+
+	for (const int idx : m_drained_cells)
+	{
+		if (!m_is_unread[idx])
+		{
+			m_is_unread[idx] = true;
+			m_unread_cells.push_back(idx);
+		}
+	}
+}
+
+// Copies the cells that changed since the buffer was last written, or the whole map
+void GenerationWorker::update_back_buffer(MapSnapshot& snapshot, const int buffer_idx)
+{
+	const int cell_count = m_generator.get_cell_count();
+	vector<int>& pending_cells = m_pending_cells[buffer_idx];
+	vector<bool>& is_pending = m_is_pending[buffer_idx];
+
+	if (m_is_pending_full[buffer_idx] || static_cast<int>(snapshot.tiles.size()) != cell_count)
+	{
+		snapshot.tiles.clear();
+		snapshot.tiles.reserve(cell_count);
+		for (int idx = 0; idx < cell_count; ++idx)
+		{
+			snapshot.tiles.push_back(m_generator.get_tile(idx));
+		}
+
+		m_is_pending_full[buffer_idx] = false;
+		is_pending.assign(cell_count, false);
+		pending_cells.clear();
+		return;
+	}
+
+	for (const int idx : pending_cells)
+	{
+		snapshot.tiles[idx] = m_generator.get_tile(idx);
+		is_pending[idx] = false;
+	}
+	pending_cells.clear();
+}
+
+bool GenerationWorker::is_idle() const
+{
+	return !m_is_stop_requested && !m_is_restart_requested && (!m_is_running || m_generator.is_tile_map_finished());
+}
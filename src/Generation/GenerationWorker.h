@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Data/Tile.h"
+#include "Data/TileSet.h"
+#include "TileMapGenerator.h"
+#include "Util/TripleBuffer.h"
+
+using std::vector;
+
+/**
+ * @class GenerationWorker
+ * @brief Runs a TileMapGenerator on its own thread and publishes immutable snapshots of the map through a
+ * lock-free TripleBuffer, so a render loop never waits on the solver nor the solver on rendering.
+ * Commands (start, pause, restart, pacing) are requests the worker picks up between steps.
+ * A contradiction that backtracking couldn't repair restarts the map
+ */
+class GenerationWorker
+{
+public:
+	struct Settings {
+		int width = 12;
+		int height = 9;
+		TileMapGenerator::PropagatorType propagator = TileMapGenerator::PropagatorType::DomainScan;
+		TileMapGenerator::BacktrackingSettings backtracking;
+		// steps per second while running, 0 runs at full speed
+		double steps_per_second = 0;
+	};
+
+	struct MapSnapshot {
+		// increases by one per published snapshot, 0 until the first one
+		uint64_t sequence = 0;
+		int width = 0;
+		int height = 0;
+		vector<Tile> tiles;
+		// cells changed since the snapshot with sequence dirty_base_sequence, the last one the reader took when this
+		// snapshot was written. Snapshots the reader skipped are covered as well
+		vector<int> dirty_cells;
+		uint64_t dirty_base_sequence = 0;
+		// true if the map was (re)initialized since dirty_base_sequence, dirty_cells is then meaningless
+		bool is_fully_dirty = true;
+		TileMapGenerator::GenerationResult result;
+		int remaining_cells = 0;
+		// maps restarted after an unrepaired contradiction, since the worker started
+		int contradiction_restarts = 0;
+	};
+
+	/**
+	 * @brief Starts the worker thread and initializes a map, paused
+	 * @param tile_set Must outlive the worker
+	 */
+	GenerationWorker(const TileSet& tile_set, const Settings& settings);
+
+	/**
+	 * @brief Cancels the current map and joins the worker thread
+	 */
+	~GenerationWorker();
+
+	GenerationWorker(const GenerationWorker&) = delete;
+	GenerationWorker& operator=(const GenerationWorker&) = delete;
+
+	// commands, picked up by the worker before its next step
+	void set_running(bool is_running);
+	void set_steps_per_second(double steps_per_second);
+
+	/**
+	 * @brief Cancels the current map and initializes a new one, keeps the running state
+	 */
+	void request_restart();
+
+	/**
+	 * @brief Returns the newest published snapshot without locking. Valid until the next call, only call from one thread
+	 */
+	const MapSnapshot& acquire_snapshot();
+
+private:
+	// how long the worker generates at full speed before publishing
+	static constexpr std::chrono::microseconds PUBLISH_INTERVAL{4000};
+	static constexpr int BUFFER_COUNT = 3;
+
+	using Clock = std::chrono::steady_clock;
+
+	const Settings m_settings;
+	TileMapGenerator m_generator;
+	TripleBuffer<MapSnapshot> m_snapshots;
+
+	// worker thread state
+	uint64_t m_sequence = 0;
+	int m_contradiction_restarts = 0;
+	vector<int> m_drained_cells;
+	// cells changed since the last snapshot the reader took
+	vector<int> m_unread_cells;
+	vector<bool> m_is_unread;
+	bool m_is_unread_fully_dirty = true;
+	uint64_t m_unread_base_sequence = 0;
+	// per buffer: cells that changed since the buffer was last written, or everything
+	std::array<vector<int>, BUFFER_COUNT> m_pending_cells;
+	std::array<vector<bool>, BUFFER_COUNT> m_is_pending;
+	std::array<bool, BUFFER_COUNT> m_is_pending_full{true, true, true};
+
+	// commands, written under m_command_mutex so the worker doesn't miss a wake-up
+	std::mutex m_command_mutex;
+	std::condition_variable m_command_condition;
+	std::atomic<bool> m_is_running = false;
+	std::atomic<bool> m_is_restart_requested = false;
+	std::atomic<bool> m_is_stop_requested = false;
+	std::atomic<double> m_steps_per_second;
+
+	std::thread m_thread;
+
+	void run();
+	bool run_steps(double& step_credit, Clock::time_point& last_time);
+	void publish();
+	void update_back_buffer(MapSnapshot& snapshot, int buffer_idx);
+	void update_unread_cells(bool is_fully_dirty);
+	bool is_idle() const;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+
+#include "Data/TileSet.h"
+
+using std::vector;
+
+/**
+ * @class NeighborTable
+ * @brief Base of the topology policies of BasicTileMapGenerator. The neighbor of every cell
+ * on every side is computed once per map size, so propagation looks it up with one load instead of converting the
+ * index to coordinates and bounds checking them. Sides without a neighbor hold the NO_NEIGHBOR sentinel.
+ * Cells are indexed layer-major, then row-major: idx = (layer * height + row) * width + col
+ */
+template <int SIDES>
+class NeighborTable
+{
+public:
+	static constexpr int SIDE_COUNT = SIDES;
+	static constexpr int NO_NEIGHBOR = -1;
+
+	int get_width() const { return m_width; }
+	int get_height() const { return m_height; }
+	int get_depth() const { return m_depth; }
+	int get_cell_count() const { return m_width * m_height * m_depth; }
+
+	int get_neighbor(const int idx, const int side) const { return m_neighbors[static_cast<size_t>(idx) * SIDE_COUNT + side]; }
+
+	// SIDE_COUNT neighbors of the cell, indexed by side
+	const int* get_neighbors(const int idx) const { return m_neighbors.data() + static_cast<size_t>(idx) * SIDE_COUNT; }
+
+protected:
+	int m_width = 0, m_height = 0, m_depth = 0;
+	vector<int> m_neighbors;
+
+	/**
+	 * @brief Fills the table unless the size didn't change. move(side, layer, row, col) moves the coordinates to the
+	 * neighbor on that side, coordinates outside the grid mean there is none
+	 */
+	template <typename MoveFunc>
+	void build(const int width, const int height, const int depth, MoveFunc&& move)
+	{
+		if (width == m_width && height == m_height && depth == m_depth)
+		{
+			return;
+		}
+
+		m_width = width;
+		m_height = height;
+		m_depth = depth;
+		m_neighbors.resize(static_cast<size_t>(get_cell_count()) * SIDE_COUNT);
+
+		int* neighbor = m_neighbors.data();
+		for (int layer = 0; layer < depth; ++layer)
+		{
+			for (int row = 0; row < height; ++row)
+			{
+				for (int col = 0; col < width; ++col)
+				{
+					for (int side = 0; side < SIDE_COUNT; ++side)
+					{
+						int neighbor_layer = layer, neighbor_row = row, neighbor_col = col;
+						move(side, neighbor_layer, neighbor_row, neighbor_col);
+						const bool has_neighbor = neighbor_layer >= 0 && neighbor_layer < depth && neighbor_row >= 0 && neighbor_row < height
+							&& neighbor_col >= 0 && neighbor_col < width;
+
+						*neighbor++ = has_neighbor ? (neighbor_layer * height + neighbor_row) * width + neighbor_col : NO_NEIGHBOR;
+					}
+				}
+			}
+		}
+	}
+};
+
+// Bounded width x height grid with the TileSet's 4 sides, depth is ignored
+class SquareGrid : public NeighborTable<TileSet::NUMBER_OF_SIDES>
+{
+public:
+	void resize(const int width, const int height, [[maybe_unused]] const int depth = 1)
+	{
+		build(width, height, 1, [](const int side, int& /* layer */, int& row, int& col)
+		{
+			row += ROW_OFFSETS[side];
+			col += COL_OFFSETS[side];
+		});
+	}
+
+	static constexpr int ROW_OFFSETS[SIDE_COUNT] = {-1, 0, 1, 0};
+	static constexpr int COL_OFFSETS[SIDE_COUNT] = {0, 1, 0, -1};
+	static_assert(TileSet::TOP_SIDE_IDX == 0 && TileSet::RIGHT_SIDE_IDX == 1 && TileSet::BOTTOM_SIDE_IDX == 2 && TileSet::LEFT_SIDE_IDX == 3);
+};
+
+// Square grid that wraps around on both axes, so the map tiles seamlessly
+class ToroidalGrid : public NeighborTable<TileSet::NUMBER_OF_SIDES>
+{
+public:
+	void resize(const int width, const int height, [[maybe_unused]] const int depth = 1)
+	{
+		build(width, height, 1, [width, height](const int side, int& /* layer */, int& row, int& col)
+		{
+			row = (row + SquareGrid::ROW_OFFSETS[side] + height) % height;
+			col = (col + SquareGrid::COL_OFFSETS[side] + width) % width;
+		});
+	}
+};
+
+/**
+ * Hex grid of pointy-top hexagons in rows, odd rows are shifted half a cell to the right. Sides are the TileSet's
+ * HEX_*_SIDE_IDX constants, clockwise from the upper right
+ */
+class HexGrid : public NeighborTable<TileSet::HEX_NUMBER_OF_SIDES>
+{
+public:
+	void resize(const int width, const int height, [[maybe_unused]] const int depth = 1)
+	{
+		// column offsets by row parity, the row offsets are the same for both
+		constexpr int ROW_OFFSETS[SIDE_COUNT] = {-1, 0, 1, 1, 0, -1};
+		constexpr int EVEN_ROW_COL_OFFSETS[SIDE_COUNT] = {0, 1, 0, -1, -1, -1};
+		constexpr int ODD_ROW_COL_OFFSETS[SIDE_COUNT] = {1, 1, 1, 0, -1, 0};
+		static_assert(TileSet::HEX_NORTH_EAST_SIDE_IDX == 0 && TileSet::HEX_EAST_SIDE_IDX == 1 && TileSet::HEX_SOUTH_EAST_SIDE_IDX == 2
+			&& TileSet::HEX_SOUTH_WEST_SIDE_IDX == 3 && TileSet::HEX_WEST_SIDE_IDX == 4 && TileSet::HEX_NORTH_WEST_SIDE_IDX == 5);
+
+		build(width, height, 1, [&](const int side, int& /* layer */, int& row, int& col)
+		{
+			col += (row % 2 == 0 ? EVEN_ROW_COL_OFFSETS : ODD_ROW_COL_OFFSETS)[side];
+			row += ROW_OFFSETS[side];
+		});
+	}
+};
+
+// Bounded width x height x depth volume, sides are the TileSet's VOXEL_*_SIDE_IDX constants
+class VoxelGrid : public NeighborTable<TileSet::VOXEL_NUMBER_OF_SIDES>
+{
+public:
+	void resize(const int width, const int height, const int depth = 1)
+	{
+		constexpr int LAYER_OFFSETS[SIDE_COUNT] = {0, 0, 1, 0, 0, -1};
+		constexpr int ROW_OFFSETS[SIDE_COUNT] = {-1, 0, 0, 1, 0, 0};
+		constexpr int COL_OFFSETS[SIDE_COUNT] = {0, 1, 0, 0, -1, 0};
+		static_assert(TileSet::VOXEL_NORTH_SIDE_IDX == 0 && TileSet::VOXEL_EAST_SIDE_IDX == 1 && TileSet::VOXEL_UP_SIDE_IDX == 2
+			&& TileSet::VOXEL_SOUTH_SIDE_IDX == 3 && TileSet::VOXEL_WEST_SIDE_IDX == 4 && TileSet::VOXEL_DOWN_SIDE_IDX == 5);
+
+		build(width, height, depth, [&](const int side, int& layer, int& row, int& col)
+		{
+			layer += LAYER_OFFSETS[side];
+			row += ROW_OFFSETS[side];
+			col += COL_OFFSETS[side];
+		});
+	}
+};
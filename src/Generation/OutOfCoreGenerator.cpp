@@ -0,0 +1,386 @@
+#include "OutOfCoreGenerator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "Generation/GridTopology.h"
+
+OutOfCoreGenerator::OutOfCoreGenerator(const TileSet& tile_set, string state_path)
+	: m_tile_set{tile_set}, m_adjacency{*tile_set.adjacency}, m_state_path{std::move(state_path)},
+	m_tile_count{tile_set.get_tile_count()}, m_word_count{Domain::words_for(tile_set.get_tile_count())},
+	m_cell_bytes{cell_bytes_for(tile_set.get_tile_count())}, m_tile_weights{tile_set}, m_mask_union{*tile_set.adjacency}
+{
+	const Domain& full_domain = tile_set.get_full_domain();
+	m_full_domain.assign(full_domain.words(), full_domain.words() + full_domain.word_count());
+
+	m_domain.resize(m_word_count);
+	m_neighbor_domain.resize(m_word_count);
+}
+
+int OutOfCoreGenerator::cell_bytes_for(const int tile_count)
+{
+	if (tile_count > Domain::BITS_PER_WORD)
+	{
+		return Domain::words_for(tile_count) * static_cast<int>(sizeof(uint64_t));
+	}
+
+	return static_cast<int>(std::bit_ceil(static_cast<unsigned int>((tile_count + 7) / 8)));
+}
+
+TileMapGenerator::GenerationResult OutOfCoreGenerator::generate(const int width, const int height)
+{
+	m_width = width;
+	m_height = height;
+	m_blocks_per_row = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_blocks_per_column = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_result = TileMapGenerator::GenerationResult{};
+
+	// release the previous map's mapping before its file is truncated
+	m_state.reset();
+	m_cells = nullptr;
+
+	const size_t state_size = static_cast<size_t>(m_blocks_per_row) * m_blocks_per_column * BLOCK_CELLS * m_cell_bytes;
+	m_state = std::make_unique<MappedFile>(m_state_path, state_size);
+	if (!m_state->is_open())
+	{
+		std::cerr << "Failed to map state file: " << m_state_path << std::endl;
+		return m_result;
+	}
+	m_cells = m_state->writable_data();
+
+	m_block_entropy.resize(BLOCK_CELLS);
+	m_block_noise.resize(BLOCK_CELLS);
+
+	// row-major block order: a block's neighbors above and to the left are solved, the ones below are mostly untouched
+	for (int block_row = 0; block_row < m_blocks_per_column; ++block_row)
+	{
+		for (int block_col = 0; block_col < m_blocks_per_row; ++block_col)
+		{
+			if (!solve_block(block_row, block_col))
+			{
+				return m_result;
+			}
+		}
+	}
+
+	m_result.status = TileMapGenerator::GenerationStatus::Finished;
+	return m_result;
+}
+
+int64_t OutOfCoreGenerator::get_storage_idx(const int row, const int col) const
+{
+	const int64_t block_idx = static_cast<int64_t>(row / BLOCK_SIZE) * m_blocks_per_row + col / BLOCK_SIZE;
+	return block_idx * BLOCK_CELLS + get_local_idx(row, col);
+}
+
+// The state file stores banned tiles, so its zeroed pages read as full domains
+void OutOfCoreGenerator::load_domain(const int row, const int col, uint64_t* words) const
+{
+	const uint8_t* cell = m_cells + get_storage_idx(row, col) * m_cell_bytes;
+
+	switch (m_cell_bytes)
+	{
+	case 1:
+		words[0] = cell[0];
+		break;
+
+	case 2:
+	{
+		uint16_t banned;
+		std::memcpy(&banned, cell, sizeof(banned));
+		words[0] = banned;
+		break;
+	}
+
+	case 4:
+	{
+		uint32_t banned;
+		std::memcpy(&banned, cell, sizeof(banned));
+		words[0] = banned;
+		break;
+	}
+
+	default:
+		std::memcpy(words, cell, m_word_count * sizeof(uint64_t));
+		break;
+	}
+
+	for (int i = 0; i < m_word_count; ++i)
+	{
+		words[i] = ~words[i] & m_full_domain[i];
+	}
+}
+
+void OutOfCoreGenerator::store_domain(const int row, const int col, const uint64_t* words)
+{
+	uint8_t* cell = m_cells + get_storage_idx(row, col) * m_cell_bytes;
+
+	switch (m_cell_bytes)
+	{
+	case 1:
+		cell[0] = static_cast<uint8_t>(~words[0] & m_full_domain[0]);
+		break;
+
+	case 2:
+	{
+		const uint16_t banned = static_cast<uint16_t>(~words[0] & m_full_domain[0]);
+		std::memcpy(cell, &banned, sizeof(banned));
+		break;
+	}
+
+	case 4:
+	{
+		const uint32_t banned = static_cast<uint32_t>(~words[0] & m_full_domain[0]);
+		std::memcpy(cell, &banned, sizeof(banned));
+		break;
+	}
+
+	default:
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			const uint64_t banned = ~words[i] & m_full_domain[i];
+			std::memcpy(cell + i * sizeof(uint64_t), &banned, sizeof(banned));
+		}
+		break;
+	}
+}
+
+// Stores a changed domain, recording the previous one on the trail so the block attempt can be undone
+void OutOfCoreGenerator::set_domain(const int row, const int col, const uint64_t* words)
+{
+	const size_t trail_offset = m_trail_words.size();
+	m_trail.push_back(Coord{row, col});
+	m_trail_words.resize(trail_offset + m_word_count);
+	load_domain(row, col, m_trail_words.data() + trail_offset);
+
+	store_domain(row, col, words);
+}
+
+int OutOfCoreGenerator::count_domain(const uint64_t* words) const
+{
+	int count = 0;
+	for (int i = 0; i < m_word_count; ++i)
+	{
+		count += std::popcount(words[i]);
+	}
+
+	return count;
+}
+
+/**
+ * Collapses every cell of the block in entropy order. Propagation may prune cells of any block, on contradiction
+ * all of it is undone and the block is retried with the next random numbers
+ */
+bool OutOfCoreGenerator::solve_block(const int block_row, const int block_col)
+{
+	m_block_row = block_row;
+	m_block_col = block_col;
+
+	for (int attempt = 0; attempt < m_max_block_attempts; ++attempt)
+	{
+		m_trail.clear();
+		m_trail_words.clear();
+		m_result = TileMapGenerator::GenerationResult{};
+		init_block_heap();
+
+		bool is_contradiction = false;
+		while (const std::optional<Coord> cell = get_next_cell_to_collapse())
+		{
+			load_domain(cell->row, cell->col, m_domain.data());
+			const int selected_tile = random_domain_tile(m_domain.data());
+
+			std::fill(m_domain.begin(), m_domain.end(), 0);
+			m_domain[selected_tile / Domain::BITS_PER_WORD] |= uint64_t{1} << (selected_tile % Domain::BITS_PER_WORD);
+			set_domain(cell->row, cell->col, m_domain.data());
+
+			if (!propagate(cell.value()))
+			{
+				is_contradiction = true;
+				break;
+			}
+		}
+
+		if (!is_contradiction)
+		{
+			return true;
+		}
+
+		undo_trail();
+	}
+
+	return false;
+}
+
+void OutOfCoreGenerator::init_block_heap()
+{
+	constexpr double MAX_NOISE = 1e-6;
+
+	m_entropy_heap = EntropyHeap{};
+
+	const int first_row = m_block_row * BLOCK_SIZE;
+	const int first_col = m_block_col * BLOCK_SIZE;
+	for (int row = first_row; row < std::min(first_row + BLOCK_SIZE, m_height); ++row)
+	{
+		for (int col = first_col; col < std::min(first_col + BLOCK_SIZE, m_width); ++col)
+		{
+			m_block_noise[get_local_idx(row, col)] = random_unit(m_random) * MAX_NOISE;
+
+			load_domain(row, col, m_domain.data());
+			push_block_cell(row, col, m_domain.data());
+		}
+	}
+}
+
+// Pushes an up to date heap entry for a cell of the current block, older entries become stale
+void OutOfCoreGenerator::push_block_cell(const int row, const int col, const uint64_t* words)
+{
+	const int local_idx = get_local_idx(row, col);
+	if (count_domain(words) <= 1)
+	{
+		m_block_entropy[local_idx] = 0;
+		return;
+	}
+
+	m_block_entropy[local_idx] = m_tile_weights.get_entropy(words) + m_block_noise[local_idx];
+	m_entropy_heap.push(EntropyEntry{m_block_entropy[local_idx], local_idx});
+}
+
+std::optional<OutOfCoreGenerator::Coord> OutOfCoreGenerator::get_next_cell_to_collapse()
+{
+	while (!m_entropy_heap.empty())
+	{
+		const EntropyEntry entry = m_entropy_heap.top();
+		m_entropy_heap.pop();
+
+		if (entry.entropy != m_block_entropy[entry.local_idx])
+		{
+			// stale entry, the cell collapsed or a newer one was pushed when its domain changed
+			continue;
+		}
+
+		m_block_entropy[entry.local_idx] = 0;
+		return Coord{m_block_row * BLOCK_SIZE + entry.local_idx / BLOCK_SIZE, m_block_col * BLOCK_SIZE + entry.local_idx % BLOCK_SIZE};
+	}
+
+	return std::nullopt;
+}
+
+int OutOfCoreGenerator::random_domain_tile(const uint64_t* words)
+{
+	return m_tile_weights.sample(words, random_unit(m_random) * m_tile_weights.get_weight_sum(words));
+}
+
+/**
+ * Domain propagation from a changed cell: each neighbor keeps the tiles allowed next to any tile still possible in the cell.
+ * Returns false on contradiction
+ */
+bool OutOfCoreGenerator::propagate(const Coord start)
+{
+	m_update_queue.clear();
+	m_update_queue.push_back(start);
+
+	for (size_t head = 0; head < m_update_queue.size(); ++head)
+	{
+		const Coord cell = m_update_queue[head];
+		load_domain(cell.row, cell.col, m_domain.data());
+
+		for (int side = 0; side < SquareGrid::SIDE_COUNT; ++side)
+		{
+			const int neighbor_row = cell.row + SquareGrid::ROW_OFFSETS[side];
+			const int neighbor_col = cell.col + SquareGrid::COL_OFFSETS[side];
+			if (!is_in_map(neighbor_row, neighbor_col))
+			{
+				continue;
+			}
+
+			const uint64_t* allowed = m_mask_union.compute(m_domain.data(), side);
+			load_domain(neighbor_row, neighbor_col, m_neighbor_domain.data());
+			bool is_changed = false;
+			bool is_empty = true;
+			for (int i = 0; i < m_word_count; ++i)
+			{
+				const uint64_t pruned = m_neighbor_domain[i] & allowed[i];
+				is_changed |= pruned != m_neighbor_domain[i];
+				is_empty &= pruned == 0;
+				m_neighbor_domain[i] = pruned;
+			}
+
+			if (!is_changed)
+			{
+				continue;
+			}
+
+			if (is_empty)
+			{
+				m_result.status = TileMapGenerator::GenerationStatus::Contradiction;
+				m_result.contradiction_idx = neighbor_row * m_width + neighbor_col;
+				return false;
+			}
+
+			set_domain(neighbor_row, neighbor_col, m_neighbor_domain.data());
+			if (is_in_block(neighbor_row, neighbor_col))
+			{
+				push_block_cell(neighbor_row, neighbor_col, m_neighbor_domain.data());
+			}
+			m_update_queue.push_back(Coord{neighbor_row, neighbor_col});
+		}
+	}
+
+	return true;
+}
+
+// Restores the domains changed by the current block attempt, in reverse order
+void OutOfCoreGenerator::undo_trail()
+{
+	for (size_t i = m_trail.size(); i-- > 0;)
+	{
+		store_domain(m_trail[i].row, m_trail[i].col, m_trail_words.data() + i * m_word_count);
+	}
+
+	m_trail.clear();
+	m_trail_words.clear();
+}
+
+int OutOfCoreGenerator::get_collapsed_id(const int row, const int col) const
+{
+	vector<uint64_t> words(m_word_count);
+	return get_collapsed_id(row, col, words.data());
+}
+
+int OutOfCoreGenerator::get_collapsed_id(const int row, const int col, uint64_t* words) const
+{
+	load_domain(row, col, words);
+	if (count_domain(words) != 1)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < m_word_count; ++i)
+	{
+		if (words[i] != 0)
+		{
+			return i * Domain::BITS_PER_WORD + std::countr_zero(words[i]);
+		}
+	}
+
+	return -1;
+}
+
+bool OutOfCoreGenerator::write(const string& path, const TileMapWriter::Format format) const
+{
+	if (m_cells == nullptr)
+	{
+		return false;
+	}
+
+	vector<uint64_t> words(m_word_count);
+	return TileMapWriter::write(path, format, m_width, m_height, m_tile_count, [this, &words](const int row, vector<int>& row_ids)
+	{
+		for (int col = 0; col < m_width; ++col)
+		{
+			row_ids[col] = get_collapsed_id(row, col, words.data());
+		}
+	});
+}
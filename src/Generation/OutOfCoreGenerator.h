@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "Data/AdjacencyTable.h"
+#include "Data/MaskUnion.h"
+#include "Data/TileMapWriter.h"
+#include "Data/TileSet.h"
+#include "Data/TileWeights.h"
+#include "TileMapGenerator.h"
+#include "Util/MappedFile.h"
+#include "Util/Random.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @class OutOfCoreGenerator
+ * @brief Generates maps larger than memory. Each cell only stores its domain as a compact bitset of banned tiles,
+ * 1 to 8 bytes for up to 64 tiles, in a memory-mapped state file, so a zeroed, sparse file is a map of uncollapsed cells.
+ * Cells are stored in BLOCK_SIZE x BLOCK_SIZE blocks and solved block by block with a block-local entropy heap and
+ * domain propagation, which keeps the working set to a few blocks of pages. A contradiction undoes the block's changes
+ * and retries the block, the map only fails when a block runs out of attempts
+ */
+class OutOfCoreGenerator
+{
+public:
+	static constexpr int BLOCK_SIZE = 64;
+	static constexpr int BLOCK_CELLS = BLOCK_SIZE * BLOCK_SIZE;
+
+	/**
+	 * @param state_path File holding the cell state while generating, created or overwritten by generate
+	 */
+	OutOfCoreGenerator(const TileSet& tile_set, string state_path);
+
+	void set_seed(const uint64_t seed) { m_random.seed(seed); }
+
+	/**
+	 * @brief Attempts to solve a block before the map fails with a contradiction
+	 */
+	void set_max_block_attempts(const int max_block_attempts) { m_max_block_attempts = max_block_attempts; }
+
+	/**
+	 * @brief Generates a width x height map into the state file.
+	 * @return Finished or Contradiction, InProgress if the state file couldn't be created
+	 */
+	TileMapGenerator::GenerationResult generate(int width, int height);
+
+	int get_width() const { return m_width; }
+	int get_height() const { return m_height; }
+
+	// Bytes of the state file per cell
+	int get_cell_bytes() const { return m_cell_bytes; }
+
+	/**
+	 * @brief Returns the collapsed tile ID of the cell, -1 if it didn't collapse
+	 */
+	int get_collapsed_id(int row, int col) const;
+
+	/**
+	 * @brief Streams the collapsed tile IDs to a file row by row, see TileMapWriter
+	 */
+	bool write(const string& path, TileMapWriter::Format format) const;
+
+private:
+	struct Coord {
+		int row;
+		int col;
+	};
+
+	struct EntropyEntry {
+		double entropy;
+		int local_idx;
+
+		bool operator>(const EntropyEntry& other) const { return entropy > other.entropy; }
+	};
+
+	// Min-heap of the current block's cells, entries are stale if the cell's entropy changed since they were pushed
+	using EntropyHeap = std::priority_queue<EntropyEntry, vector<EntropyEntry>, std::greater<>>;
+
+	const TileSet& m_tile_set;
+	const AdjacencyTable& m_adjacency;
+	const string m_state_path;
+	Xoshiro256 m_random;
+	int m_max_block_attempts = 20;
+
+	const int m_tile_count;
+	const int m_word_count;
+	// bytes per cell in the state file: 1, 2, 4 or 8 for up to 64 tiles, 8 per word otherwise
+	const int m_cell_bytes;
+	vector<uint64_t> m_full_domain;
+	TileWeights m_tile_weights;
+	// tiles a neighbor may keep
+	MaskUnion m_mask_union;
+
+	int m_width = 0, m_height = 0;
+	int m_blocks_per_row = 0, m_blocks_per_column = 0;
+	std::unique_ptr<MappedFile> m_state;
+	uint8_t* m_cells = nullptr;
+	TileMapGenerator::GenerationResult m_result;
+
+	// state of the block being solved
+	int m_block_row = 0, m_block_col = 0;
+	EntropyHeap m_entropy_heap;
+	vector<double> m_block_entropy;
+	vector<double> m_block_noise;
+
+	vector<Coord> m_update_queue;
+	// cells changed by the current block attempt and their previous domains, m_trail_words holds m_word_count words per entry
+	vector<Coord> m_trail;
+	vector<uint64_t> m_trail_words;
+
+	// scratch domains
+	vector<uint64_t> m_domain, m_neighbor_domain;
+
+	static int cell_bytes_for(int tile_count);
+
+	int64_t get_storage_idx(int row, int col) const;
+	bool is_in_map(const int row, const int col) const { return row >= 0 && row < m_height && col >= 0 && col < m_width; }
+	bool is_in_block(const int row, const int col) const { return row / BLOCK_SIZE == m_block_row && col / BLOCK_SIZE == m_block_col; }
+	int get_local_idx(const int row, const int col) const { return (row % BLOCK_SIZE) * BLOCK_SIZE + col % BLOCK_SIZE; }
+
+	int get_collapsed_id(int row, int col, uint64_t* words) const;
+	void load_domain(int row, int col, uint64_t* words) const;
+	void store_domain(int row, int col, const uint64_t* words);
+	void set_domain(int row, int col, const uint64_t* words);
+	int count_domain(const uint64_t* words) const;
+
+	bool solve_block(int block_row, int block_col);
+	void init_block_heap();
+	void push_block_cell(int row, int col, const uint64_t* words);
+	std::optional<Coord> get_next_cell_to_collapse();
+	int random_domain_tile(const uint64_t* words);
+	bool propagate(Coord start);
+	void undo_trail();
+};
@@ -0,0 +1,387 @@
+#include "ParallelTileMapGenerator.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "Util/DomainKernels.h"
+
+ParallelTileMapGenerator::ParallelTileMapGenerator(const TileSet& tile_set, const int thread_count)
+	: m_tile_set{tile_set}, m_adjacency{*tile_set.adjacency}, m_word_count{Domain::words_for(tile_set.get_tile_count())},
+	m_tile_weights{tile_set}, m_mask_union{m_adjacency}, m_thread_pool{std::max(1, thread_count)}
+{
+	const Domain full_domain = tile_set.get_full_domain();
+	m_full_domain.assign(full_domain.words(), full_domain.words() + m_word_count);
+
+	for (int i = 0; i < m_thread_pool.get_thread_count(); ++i)
+	{
+		auto solver = std::make_unique<BlockSolver>(m_adjacency);
+		solver->entropy.resize(BLOCK_SIZE * BLOCK_SIZE);
+		solver->noise.resize(BLOCK_SIZE * BLOCK_SIZE);
+		solver->domain.resize(m_word_count);
+		m_solvers.push_back(std::move(solver));
+	}
+}
+
+TileMapGenerator::GenerationResult ParallelTileMapGenerator::generate_tile_map(const int width, const int height)
+{
+	m_width = width;
+	m_height = height;
+	m_blocks_per_row = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_blocks_per_column = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_topology.resize(width, height);
+	m_result = TileMapGenerator::GenerationResult{};
+
+	const size_t cell_count = static_cast<size_t>(width) * height;
+	m_domains.resize(cell_count * m_word_count);
+	for (size_t idx = 0; idx < cell_count; ++idx)
+	{
+		std::copy(m_full_domain.begin(), m_full_domain.end(), m_domains.begin() + idx * m_word_count);
+	}
+
+	m_block_results.assign(static_cast<size_t>(m_blocks_per_row) * m_blocks_per_column, BlockResult{});
+
+	vector<int> phase_blocks;
+	for (int phase = 0; phase < PHASE_STRIDE * PHASE_STRIDE; ++phase)
+	{
+		phase_blocks.clear();
+		for (int block_row = phase / PHASE_STRIDE; block_row < m_blocks_per_column; block_row += PHASE_STRIDE)
+		{
+			for (int block_col = phase % PHASE_STRIDE; block_col < m_blocks_per_row; block_col += PHASE_STRIDE)
+			{
+				const int block_idx = block_row * m_blocks_per_row + block_col;
+				phase_blocks.push_back(block_idx);
+
+				m_thread_pool.submit([this, block_row, block_col, block_idx]
+				{
+					BlockSolver& solver = *m_solvers[m_thread_pool.get_current_worker_index()];
+					solve_block(solver, block_row, block_col, m_block_results[block_idx]);
+				});
+			}
+		}
+		m_thread_pool.wait_idle();
+
+		// in block order, so the map doesn't depend on which block finished first
+		for (const int block_idx : phase_blocks)
+		{
+			BlockResult& result = m_block_results[block_idx];
+			if (!result.is_solved)
+			{
+				m_result.status = TileMapGenerator::GenerationStatus::Contradiction;
+				m_result.contradiction_idx = result.contradiction_idx;
+				return m_result;
+			}
+
+			if (!apply_boundary_messages(result))
+			{
+				return m_result;
+			}
+
+			result = BlockResult{};
+		}
+	}
+
+	m_result.status = TileMapGenerator::GenerationStatus::Finished;
+	return m_result;
+}
+
+vector<int> ParallelTileMapGenerator::get_collapsed_ids() const
+{
+	vector<int> ids(static_cast<size_t>(m_width) * m_height, -1);
+	for (size_t idx = 0; idx < ids.size(); ++idx)
+	{
+		const uint64_t* words = get_domain(static_cast<int>(idx));
+		if (DomainKernels::popcount(words, m_word_count) != 1)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			if (words[i] != 0)
+			{
+				ids[idx] = i * Domain::BITS_PER_WORD + std::countr_zero(words[i]);
+				break;
+			}
+		}
+	}
+
+	return ids;
+}
+
+bool ParallelTileMapGenerator::is_full_domain(const uint64_t* words) const
+{
+	for (int i = 0; i < m_word_count; ++i)
+	{
+		if ((words[i] & m_full_domain[i]) != m_full_domain[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ParallelTileMapGenerator::is_in_block(const BlockSolver& solver, const int idx) const
+{
+	return (idx / m_width) / BLOCK_SIZE == solver.block_row && (idx % m_width) / BLOCK_SIZE == solver.block_col;
+}
+
+bool ParallelTileMapGenerator::is_in_halo(const BlockSolver& solver, const int idx) const
+{
+	const int row = idx / m_width;
+	const int col = idx % m_width;
+	return row >= solver.first_row && row < solver.last_row && col >= solver.first_col && col < solver.last_col;
+}
+
+// Worker thread: solves the block, on contradiction all of its changes are undone and it's retried with the next seed
+void ParallelTileMapGenerator::solve_block(BlockSolver& solver, const int block_row, const int block_col, BlockResult& result)
+{
+	solver.block_row = block_row;
+	solver.block_col = block_col;
+	solver.first_row = std::max(0, (block_row - 1) * BLOCK_SIZE);
+	solver.last_row = std::min(m_height, (block_row + 2) * BLOCK_SIZE);
+	solver.first_col = std::max(0, (block_col - 1) * BLOCK_SIZE);
+	solver.last_col = std::min(m_width, (block_col + 2) * BLOCK_SIZE);
+
+	const uint64_t block_idx = static_cast<uint64_t>(block_row) * m_blocks_per_row + block_col;
+	for (int attempt = 0; attempt < m_max_block_attempts; ++attempt)
+	{
+		solver.random.seed(m_seed + 0x9E3779B97F4A7C15 * (block_idx * m_max_block_attempts + attempt + 1));
+
+		if (try_solve_block(solver, result))
+		{
+			result.is_solved = true;
+			return;
+		}
+
+		undo_block(solver);
+		result.message_cells.clear();
+		result.message_masks.clear();
+	}
+}
+
+// Collapses every cell of the block in entropy order, returns false on contradiction
+bool ParallelTileMapGenerator::try_solve_block(BlockSolver& solver, BlockResult& result)
+{
+	constexpr double MAX_NOISE = 1e-6;
+
+	solver.trail.clear();
+	solver.trail_words.clear();
+	solver.entropy_heap = EntropyHeap{};
+
+	const int first_row = solver.block_row * BLOCK_SIZE;
+	const int first_col = solver.block_col * BLOCK_SIZE;
+	const int last_row = std::min(first_row + BLOCK_SIZE, m_height);
+	const int last_col = std::min(first_col + BLOCK_SIZE, m_width);
+	for (int row = first_row; row < last_row; ++row)
+	{
+		for (int col = first_col; col < last_col; ++col)
+		{
+			const int idx = row * m_width + col;
+			solver.noise[get_local_idx(idx)] = random_unit(solver.random) * MAX_NOISE;
+			push_block_cell(solver, idx);
+		}
+	}
+
+	while (!solver.entropy_heap.empty())
+	{
+		const EntropyEntry entry = solver.entropy_heap.top();
+		solver.entropy_heap.pop();
+
+		const int local_idx = get_local_idx(entry.idx);
+		if (entry.entropy != solver.entropy[local_idx])
+		{
+			// stale entry, the cell collapsed or a newer one was pushed when its domain changed
+			continue;
+		}
+		solver.entropy[local_idx] = 0;
+
+		const int selected_tile = random_domain_tile(solver, get_domain(entry.idx));
+		std::fill(solver.domain.begin(), solver.domain.end(), 0);
+		solver.domain[selected_tile / Domain::BITS_PER_WORD] |= uint64_t{1} << (selected_tile % Domain::BITS_PER_WORD);
+		set_block_domain(solver, entry.idx, solver.domain.data());
+
+		if (!propagate_block(solver, entry.idx, result))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Pushes an up to date heap entry for a cell of the block, older entries become stale
+void ParallelTileMapGenerator::push_block_cell(BlockSolver& solver, const int idx)
+{
+	const uint64_t* words = get_domain(idx);
+	const int local_idx = get_local_idx(idx);
+	if (DomainKernels::popcount(words, m_word_count) <= 1)
+	{
+		solver.entropy[local_idx] = 0;
+		return;
+	}
+
+	solver.entropy[local_idx] = m_tile_weights.get_entropy(words) + solver.noise[local_idx];
+	solver.entropy_heap.push(EntropyEntry{solver.entropy[local_idx], idx});
+}
+
+int ParallelTileMapGenerator::random_domain_tile(BlockSolver& solver, const uint64_t* words) const
+{
+	return m_tile_weights.sample(words, random_unit(solver.random) * m_tile_weights.get_weight_sum(words));
+}
+
+/**
+ * Domain propagation confined to the block's halo. A restriction of a cell outside the halo is recorded as a boundary
+ * message instead, no other block of the phase reads or writes the halo. Returns false on contradiction
+ */
+bool ParallelTileMapGenerator::propagate_block(BlockSolver& solver, const int start_idx, BlockResult& result)
+{
+	solver.update_queue.clear();
+	solver.update_queue.push_back(start_idx);
+
+	for (size_t head = 0; head < solver.update_queue.size(); ++head)
+	{
+		const int idx = solver.update_queue[head];
+		const int* neighbors = m_topology.get_neighbors(idx);
+
+		for (int side = 0; side < SquareGrid::SIDE_COUNT; ++side)
+		{
+			const int neighbor_idx = neighbors[side];
+			if (neighbor_idx == SquareGrid::NO_NEIGHBOR)
+			{
+				continue;
+			}
+
+			const uint64_t* allowed = solver.mask_union.compute(get_domain(idx), side);
+
+			if (!is_in_halo(solver, neighbor_idx))
+			{
+				if (!is_full_domain(allowed))
+				{
+					result.message_cells.push_back(neighbor_idx);
+					result.message_masks.insert(result.message_masks.end(), allowed, allowed + m_word_count);
+				}
+				continue;
+			}
+
+			const uint64_t* neighbor_words = get_domain(neighbor_idx);
+			bool is_changed = false;
+			bool is_empty = true;
+			for (int i = 0; i < m_word_count; ++i)
+			{
+				const uint64_t pruned = neighbor_words[i] & allowed[i];
+				is_changed |= pruned != neighbor_words[i];
+				is_empty &= pruned == 0;
+				solver.domain[i] = pruned;
+			}
+
+			if (!is_changed)
+			{
+				continue;
+			}
+
+			if (is_empty)
+			{
+				result.contradiction_idx = neighbor_idx;
+				return false;
+			}
+
+			set_block_domain(solver, neighbor_idx, solver.domain.data());
+			if (is_in_block(solver, neighbor_idx))
+			{
+				push_block_cell(solver, neighbor_idx);
+			}
+			solver.update_queue.push_back(neighbor_idx);
+		}
+	}
+
+	return true;
+}
+
+// Stores a changed domain, recording the previous one on the trail so the block attempt can be undone
+void ParallelTileMapGenerator::set_block_domain(BlockSolver& solver, const int idx, const uint64_t* words)
+{
+	uint64_t* domain = get_domain(idx);
+	solver.trail.push_back(idx);
+	solver.trail_words.insert(solver.trail_words.end(), domain, domain + m_word_count);
+
+	std::copy(words, words + m_word_count, domain);
+}
+
+// Restores the domains changed by the block attempt, in reverse order
+void ParallelTileMapGenerator::undo_block(BlockSolver& solver)
+{
+	for (size_t i = solver.trail.size(); i-- > 0;)
+	{
+		const uint64_t* words = solver.trail_words.data() + i * m_word_count;
+		std::copy(words, words + m_word_count, get_domain(solver.trail[i]));
+	}
+
+	solver.trail.clear();
+	solver.trail_words.clear();
+}
+
+/**
+ * Main thread, between phases: restricts the message cells and propagates from the ones that changed across the whole
+ * map. Returns false on contradiction, this can only happen if two blocks' propagations met
+ */
+bool ParallelTileMapGenerator::apply_boundary_messages(const BlockResult& result)
+{
+	vector<int> update_queue;
+
+	const auto restrict_domain = [this, &update_queue](const int idx, const uint64_t* mask)
+	{
+		uint64_t* words = get_domain(idx);
+		bool is_changed = false;
+		bool is_empty = true;
+		for (int i = 0; i < m_word_count; ++i)
+		{
+			const uint64_t pruned = words[i] & mask[i];
+			is_changed |= pruned != words[i];
+			is_empty &= pruned == 0;
+			words[i] = pruned;
+		}
+
+		if (is_empty)
+		{
+			m_result.status = TileMapGenerator::GenerationStatus::Contradiction;
+			m_result.contradiction_idx = idx;
+			return false;
+		}
+
+		if (is_changed)
+		{
+			update_queue.push_back(idx);
+		}
+		return true;
+	};
+
+	for (size_t message = 0; message < result.message_cells.size(); ++message)
+	{
+		if (!restrict_domain(result.message_cells[message], result.message_masks.data() + message * m_word_count))
+		{
+			return false;
+		}
+	}
+
+	for (size_t head = 0; head < update_queue.size(); ++head)
+	{
+		const int idx = update_queue[head];
+		const int* neighbors = m_topology.get_neighbors(idx);
+
+		for (int side = 0; side < SquareGrid::SIDE_COUNT; ++side)
+		{
+			if (neighbors[side] == SquareGrid::NO_NEIGHBOR)
+			{
+				continue;
+			}
+
+			if (!restrict_domain(neighbors[side], m_mask_union.compute(get_domain(idx), side)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
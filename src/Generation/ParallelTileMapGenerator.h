@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Data/AdjacencyTable.h"
+#include "Data/MaskUnion.h"
+#include "Data/TileSet.h"
+#include "Data/TileWeights.h"
+#include "Generation/GridTopology.h"
+#include "TileMapGenerator.h"
+#include "Util/Random.h"
+#include "Util/ThreadPool.h"
+
+using std::vector;
+
+/**
+ * @class ParallelTileMapGenerator
+ * @brief Generates one large map on all cores. The grid is partitioned into BLOCK_SIZE x BLOCK_SIZE blocks, solved
+ * in 9 phases: blocks of a phase are 3 blocks apart, so each can be solved concurrently together with its halo, the
+ * ring of blocks around it, without sharing a cell with another. Each block collapses its lowest entropy cells and
+ * propagates in its own worklist. Propagation that leaves the halo becomes a boundary message, applied between phases.
+ * A block that contradicts undoes its changes and retries. Every block draws from its own random engine seeded from
+ * the map seed and the block, so the result only depends on the seed, not on the thread count or the scheduling
+ */
+class ParallelTileMapGenerator
+{
+public:
+	static constexpr int BLOCK_SIZE = 32;
+
+	/**
+	 * @param tile_set Shared by all workers, must outlive the generator
+	 * @param thread_count Number of worker threads, defaults to the number of hardware threads
+	 */
+	explicit ParallelTileMapGenerator(const TileSet& tile_set, int thread_count = static_cast<int>(std::thread::hardware_concurrency()));
+
+	int get_thread_count() const { return m_thread_pool.get_thread_count(); }
+
+	void set_seed(const uint64_t seed) { m_seed = seed; }
+
+	/**
+	 * @brief Attempts to solve a block before the map fails with a contradiction
+	 */
+	void set_max_block_attempts(const int max_block_attempts) { m_max_block_attempts = max_block_attempts; }
+
+	TileMapGenerator::GenerationResult generate_tile_map(int width, int height);
+
+	int get_width() const { return m_width; }
+	int get_height() const { return m_height; }
+
+	/**
+	 * @brief Returns the collapsed tile ID of every cell in row-major order, -1 for cells that didn't collapse
+	 */
+	vector<int> get_collapsed_ids() const;
+
+private:
+	static constexpr int PHASE_STRIDE = 3;
+
+	struct EntropyEntry {
+		double entropy;
+		int idx;
+
+		bool operator>(const EntropyEntry& other) const { return entropy > other.entropy; }
+	};
+
+	using EntropyHeap = std::priority_queue<EntropyEntry, vector<EntropyEntry>, std::greater<>>;
+
+	// Per worker state of the block being solved
+	struct BlockSolver {
+		explicit BlockSolver(const AdjacencyTable& adjacency) : mask_union{adjacency} {}
+
+		int block_row = 0, block_col = 0;
+		// halo bounds, [first, last)
+		int first_row = 0, last_row = 0, first_col = 0, last_col = 0;
+		Xoshiro256 random;
+
+		EntropyHeap entropy_heap;
+		vector<double> entropy;
+		vector<double> noise;
+		vector<int> update_queue;
+		// changed cells and their previous domains, trail_words holds word count words per entry
+		vector<int> trail;
+		vector<uint64_t> trail_words;
+		vector<uint64_t> domain;
+		MaskUnion mask_union;
+	};
+
+	// Outcome of solving a block. Boundary messages restrict cells outside the block's halo: such a cell keeps only
+	// the tiles in its message's mask, masks holds word count words per message
+	struct BlockResult {
+		bool is_solved = false;
+		int contradiction_idx = -1;
+		vector<int> message_cells;
+		vector<uint64_t> message_masks;
+	};
+
+	const TileSet& m_tile_set;
+	const AdjacencyTable& m_adjacency;
+	const int m_word_count;
+	vector<uint64_t> m_full_domain;
+	TileWeights m_tile_weights;
+	// used by the main thread between phases, every block solver has its own
+	MaskUnion m_mask_union;
+	ThreadPool m_thread_pool;
+	vector<std::unique_ptr<BlockSolver>> m_solvers;
+
+	uint64_t m_seed = 0;
+	int m_max_block_attempts = 20;
+
+	int m_width = 0, m_height = 0;
+	int m_blocks_per_row = 0, m_blocks_per_column = 0;
+	SquareGrid m_topology;
+	// word count words per cell, row-major
+	vector<uint64_t> m_domains;
+	TileMapGenerator::GenerationResult m_result;
+
+	// indexed by block, filled by the phase that solves the block
+	vector<BlockResult> m_block_results;
+
+	uint64_t* get_domain(const int idx) { return m_domains.data() + static_cast<size_t>(idx) * m_word_count; }
+	const uint64_t* get_domain(const int idx) const { return m_domains.data() + static_cast<size_t>(idx) * m_word_count; }
+	bool is_full_domain(const uint64_t* words) const;
+
+	int get_local_idx(const int idx) const { return ((idx / m_width) % BLOCK_SIZE) * BLOCK_SIZE + (idx % m_width) % BLOCK_SIZE; }
+	bool is_in_block(const BlockSolver& solver, int idx) const;
+	bool is_in_halo(const BlockSolver& solver, int idx) const;
+
+	void solve_block(BlockSolver& solver, int block_row, int block_col, BlockResult& result);
+	bool try_solve_block(BlockSolver& solver, BlockResult& result);
+	void push_block_cell(BlockSolver& solver, int idx);
+	int random_domain_tile(BlockSolver& solver, const uint64_t* words) const;
+	bool propagate_block(BlockSolver& solver, int start_idx, BlockResult& result);
+	void set_block_domain(BlockSolver& solver, int idx, const uint64_t* words);
+	void undo_block(BlockSolver& solver);
+
+	bool apply_boundary_messages(const BlockResult& result);
+};
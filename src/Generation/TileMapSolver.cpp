@@ -0,0 +1,86 @@
+#include "TileMapSolver.h"
+
+#include "Generation/DomainWords.h"
+#include "Generation/GridTopology.h"
+
+namespace
+{
+	// TileMapSolver over one instantiation of BasicTileMapGenerator with the domain scan propagator
+	template <typename DomainWords, typename Topology>
+	class TileMapSolverInstance final : public TileMapSolver
+	{
+	public:
+		explicit TileMapSolverInstance(const TileSet& tile_set) : m_generator{tile_set} {}
+
+		void set_seed(const uint64_t seed) override { m_generator.set_seed(seed); }
+
+		TileMapGenerator::GenerationResult generate_tile_map(const int width, const int height, const int depth) override
+		{
+			return m_generator.generate_tile_map(width, height, depth);
+		}
+
+		vector<int> get_collapsed_ids() const override { return m_generator.get_collapsed_ids(); }
+
+	private:
+		BasicTileMapGenerator<DomainWords, Topology> m_generator;
+	};
+
+	template <typename Topology>
+	std::unique_ptr<TileMapSolver> create_for_topology(const TileSet& tile_set)
+	{
+		// the fixed widths have to match the tile set's adjacency masks word for word
+		switch (Domain::words_for(tile_set.get_tile_count()))
+		{
+		case FixedDomainWords<1>::word_count():
+			return std::make_unique<TileMapSolverInstance<FixedDomainWords<1>, Topology>>(tile_set);
+
+		case FixedDomainWords<2>::word_count():
+			return std::make_unique<TileMapSolverInstance<FixedDomainWords<2>, Topology>>(tile_set);
+
+		case FixedDomainWords<4>::word_count():
+			return std::make_unique<TileMapSolverInstance<FixedDomainWords<4>, Topology>>(tile_set);
+
+		default:
+			return std::make_unique<TileMapSolverInstance<DynamicDomainWords, Topology>>(tile_set);
+		}
+	}
+}
+
+std::unique_ptr<TileMapSolver> TileMapSolver::create(const TileSet& tile_set, const GridType grid_type)
+{
+	if (tile_set.get_number_of_sides() != get_number_of_sides(grid_type))
+	{
+		return nullptr;
+	}
+
+	switch (grid_type)
+	{
+	case GridType::Toroidal:
+		return create_for_topology<ToroidalGrid>(tile_set);
+
+	case GridType::Hex:
+		return create_for_topology<HexGrid>(tile_set);
+
+	case GridType::Voxel:
+		return create_for_topology<VoxelGrid>(tile_set);
+
+	case GridType::Square:
+	default:
+		return create_for_topology<SquareGrid>(tile_set);
+	}
+}
+
+int TileMapSolver::get_number_of_sides(const GridType grid_type)
+{
+	switch (grid_type)
+	{
+	case GridType::Hex:
+		return HexGrid::SIDE_COUNT;
+
+	case GridType::Voxel:
+		return VoxelGrid::SIDE_COUNT;
+
+	default:
+		return SquareGrid::SIDE_COUNT;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Data/TileSet.h"
+#include "TileMapGenerator.h"
+
+using std::vector;
+
+/**
+ * @class TileMapSolver
+ * @brief Runtime interface of the BasicTileMapGenerator instantiations, whole maps only
+ */
+class TileMapSolver
+{
+public:
+	// Grid the cells are arranged in, see GridTopology.h
+	enum class GridType { Square, Toroidal, Hex, Voxel };
+
+	virtual ~TileMapSolver() = default;
+
+	/**
+	 * @brief Seeds the solver's random engine, see TileMapGenerator::set_seed
+	 */
+	virtual void set_seed(uint64_t seed) = 0;
+
+	/**
+	 * @param depth Number of layers of a voxel grid, 1 for the 2D grids
+	 */
+	virtual TileMapGenerator::GenerationResult generate_tile_map(int width, int height, int depth = 1) = 0;
+
+	/**
+	 * @brief Returns the collapsed tile ID of every cell layer by layer in row-major order, -1 for cells that didn't collapse
+	 */
+	virtual vector<int> get_collapsed_ids() const = 0;
+
+	/**
+	 * @brief Creates the instantiation with the tile set's domain width, fixed if there is one, and with the grid's topology
+	 * @return nullptr if the grid's cells have another number of sides than the tile set's tiles
+	 */
+	static std::unique_ptr<TileMapSolver> create(const TileSet& tile_set, GridType grid_type = GridType::Square);
+
+	static int get_number_of_sides(GridType grid_type);
+};
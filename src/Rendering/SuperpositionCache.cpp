@@ -0,0 +1,187 @@
+#include "SuperpositionCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+SuperpositionCache::SuperpositionCache(const TileSet& tile_set, const TileAtlas& atlas, const int slot_size, const size_t max_bytes)
+	: m_tile_set{tile_set}, m_atlas{atlas}, m_slot_size{slot_size},
+	m_is_quantized{Domain::words_for(tile_set.get_tile_count()) > MAX_EXACT_WORDS}
+{
+	constexpr int BYTES_PER_PIXEL = 4;
+	const size_t slot_bytes = static_cast<size_t>(slot_size) * slot_size * BYTES_PER_PIXEL;
+	const int slot_count = static_cast<int>(std::max<size_t>(1, max_bytes / slot_bytes));
+
+	m_columns = static_cast<int>(std::ceil(std::sqrt(slot_count)));
+	const int rows = (slot_count + m_columns - 1) / m_columns;
+
+	m_fbo.allocate(m_columns * slot_size, rows * slot_size, GL_RGBA);
+	m_fbo.begin();
+	ofClear(0, 0, 0, 255);
+	m_fbo.end();
+
+	m_slots.resize(slot_count);
+	for (int slot_id = slot_count - 1; slot_id >= 0; --slot_id)
+	{
+		m_free_slots.push_back(slot_id);
+	}
+}
+
+std::optional<TileAtlas::QuadCoords> SuperpositionCache::get_preview(const Domain& domain)
+{
+	Key key = make_key(domain);
+
+	if (const auto it = m_slot_ids.find(key); it != m_slot_ids.end())
+	{
+		touch(it->second);
+		return get_slot_coords(it->second);
+	}
+
+	int slot_id;
+	if (!m_free_slots.empty())
+	{
+		slot_id = m_free_slots.back();
+		m_free_slots.pop_back();
+	}
+	else
+	{
+		slot_id = m_lru.front();
+
+		// the least recently used preview is still on screen, the cache is too small for this build
+		if (m_slots[slot_id].last_build_idx == m_build_idx)
+		{
+			return std::nullopt;
+		}
+
+		m_lru.pop_front();
+		m_slot_ids.erase(m_slots[slot_id].key);
+	}
+
+	render_preview(slot_id, key);
+
+	m_slots[slot_id].key = std::move(key);
+	m_slots[slot_id].lru_position = m_lru.insert(m_lru.end(), slot_id);
+	m_slots[slot_id].last_build_idx = m_build_idx;
+	m_slot_ids[m_slots[slot_id].key] = slot_id;
+
+	return get_slot_coords(slot_id);
+}
+
+void SuperpositionCache::touch(const int slot_id)
+{
+	Slot& slot = m_slots[slot_id];
+	slot.last_build_idx = m_build_idx;
+	m_lru.splice(m_lru.end(), m_lru, slot.lru_position);
+}
+
+// The domain's words, or for large tile sets one bit per bucket of consecutive tile IDs, set iff any of them is possible
+SuperpositionCache::Key SuperpositionCache::make_key(const Domain& domain) const
+{
+	if (!m_is_quantized)
+	{
+		return Key(domain.words(), domain.words() + domain.word_count());
+	}
+
+	Key key(MAX_EXACT_WORDS, 0);
+	const int tile_count = m_tile_set.get_tile_count();
+	domain.for_each([&](const int tile_id)
+	{
+		const int bucket = static_cast<int>(static_cast<int64_t>(tile_id) * QUANTIZED_BUCKETS / tile_count);
+		key[bucket / Domain::BITS_PER_WORD] |= uint64_t{1} << (bucket % Domain::BITS_PER_WORD);
+	});
+
+	return key;
+}
+
+// Blends the key's tiles onto black with equal alpha, the way uncollapsed cells were drawn one tile at a time
+void SuperpositionCache::render_preview(const int slot_id, const Key& key)
+{
+	const int tile_count = m_tile_set.get_tile_count();
+	const int bit_count = static_cast<int>(key.size()) * Domain::BITS_PER_WORD;
+	vector<int> tile_ids;
+	for (int bit = 0; bit < bit_count; ++bit)
+	{
+		if (((key[bit / Domain::BITS_PER_WORD] >> (bit % Domain::BITS_PER_WORD)) & 1) == 0)
+		{
+			continue;
+		}
+
+		if (!m_is_quantized)
+		{
+			tile_ids.push_back(bit);
+			continue;
+		}
+
+		// every tile ID of the bucket, the inverse of the mapping in make_key
+		for (int tile_id = static_cast<int>((static_cast<int64_t>(bit) * tile_count + QUANTIZED_BUCKETS - 1) / QUANTIZED_BUCKETS);
+			 tile_id < tile_count && static_cast<int64_t>(tile_id) * QUANTIZED_BUCKETS / tile_count == bit; ++tile_id)
+		{
+			tile_ids.push_back(tile_id);
+		}
+	}
+
+	const float x = (slot_id % m_columns) * m_slot_size;
+	const float y = (slot_id / m_columns) * m_slot_size;
+	const float size = m_slot_size;
+
+	ofMesh mesh;
+	mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	const ofFloatColor color(1, 1, 1, tile_ids.empty() ? 0 : 1.0f / tile_ids.size());
+	const glm::vec3 corners[4]{{x, y, 0}, {x + size, y, 0}, {x + size, y + size, 0}, {x, y + size, 0}};
+
+	for (const int tile_id : tile_ids)
+	{
+		const ofIndexType first_vertex = mesh.getNumVertices();
+		const TileAtlas::QuadCoords& coords = m_atlas.get_coords(tile_id);
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			mesh.addVertex(corners[corner]);
+			mesh.addTexCoord(coords[corner]);
+			mesh.addColor(color);
+		}
+		mesh.addIndices({first_vertex, first_vertex + 1, first_vertex + 2, first_vertex, first_vertex + 2, first_vertex + 3});
+	}
+
+	m_fbo.begin();
+	ofPushStyle();
+
+	ofSetColor(ofColor::black);
+	ofDisableAlphaBlending();
+	ofDrawRectangle(x, y, size, size);
+	ofEnableAlphaBlending();
+
+	ofSetColor(ofColor::white);
+	m_atlas.get_texture().bind();
+	mesh.draw();
+	m_atlas.get_texture().unbind();
+
+	ofPopStyle();
+	m_fbo.end();
+}
+
+TileAtlas::QuadCoords SuperpositionCache::get_slot_coords(const int slot_id) const
+{
+	// inset by half a texel so linear filtering doesn't bleed in the neighboring slots
+	const float left = (slot_id % m_columns) * m_slot_size + 0.5f;
+	const float top = (slot_id / m_columns) * m_slot_size + 0.5f;
+	const float right = left + m_slot_size - 1;
+	const float bottom = top + m_slot_size - 1;
+
+	const ofTexture& texture = m_fbo.getTexture();
+	return TileAtlas::QuadCoords{
+		texture.getCoordFromPoint(left, top),
+		texture.getCoordFromPoint(right, top),
+		texture.getCoordFromPoint(right, bottom),
+		texture.getCoordFromPoint(left, bottom)
+	};
+}
+
+size_t SuperpositionCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = key.size();
+	for (const uint64_t word : key)
+	{
+		hash ^= std::hash<uint64_t>{}(word) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+	}
+
+	return hash;
+}
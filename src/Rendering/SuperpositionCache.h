@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "ofMain.h"
+#include "Data/TileSet.h"
+#include "Rendering/TileAtlas.h"
+
+using std::vector;
+using std::unordered_map;
+
+/**
+ * @class SuperpositionCache
+ * @brief Renders the blended preview of each distinct superposition once into a slot of a shared FBO and reuses it,
+ * so an uncollapsed cell costs one quad instead of one per possible tile.
+ * Previews are keyed by the domain's bitmask, or for large tile sets by a quantized signature that merges
+ * neighboring tile IDs into buckets. Slots are evicted least recently used within a fixed memory budget
+ */
+class SuperpositionCache
+{
+public:
+	// tile sets with more words per domain are keyed by a quantized signature
+	static constexpr int MAX_EXACT_WORDS = 4;
+	static constexpr int QUANTIZED_BUCKETS = MAX_EXACT_WORDS * Domain::BITS_PER_WORD;
+
+	/**
+	 * @param slot_size Width and height of a preview in pixels
+	 * @param max_bytes Memory budget of the preview FBO, decides the number of slots
+	 */
+	SuperpositionCache(const TileSet& tile_set, const TileAtlas& atlas, int slot_size, size_t max_bytes);
+
+	/**
+	 * @brief Starts a new mesh build. Previews returned since the last call may be evicted again
+	 */
+	void begin_build() { m_build_idx++; }
+
+	/**
+	 * @brief Returns the texture coordinates of the domain's preview, rendering it on a miss.
+	 * Returns nullopt if every slot already holds a preview used by the current build
+	 */
+	std::optional<TileAtlas::QuadCoords> get_preview(const Domain& domain);
+
+	const ofTexture& get_texture() const { return m_fbo.getTexture(); }
+
+private:
+	using Key = vector<uint64_t>;
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	struct Slot
+	{
+		Key key;
+		uint64_t last_build_idx = 0;
+		// position in m_lru, the front is the least recently used slot
+		std::list<int>::iterator lru_position;
+	};
+
+	const TileSet& m_tile_set;
+	const TileAtlas& m_atlas;
+	const int m_slot_size;
+	const bool m_is_quantized;
+	int m_columns = 0;
+
+	ofFbo m_fbo;
+	vector<Slot> m_slots;
+	std::list<int> m_lru;
+	unordered_map<Key, int, KeyHash> m_slot_ids;
+	// free slots, taken before anything is evicted
+	vector<int> m_free_slots;
+	uint64_t m_build_idx = 1;
+
+	Key make_key(const Domain& domain) const;
+	void render_preview(int slot_id, const Key& key);
+	TileAtlas::QuadCoords get_slot_coords(int slot_id) const;
+	void touch(int slot_id);
+};
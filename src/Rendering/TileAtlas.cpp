@@ -0,0 +1,175 @@
+#include "TileAtlas.h"
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+TileAtlas::TileAtlas(const TileSet& tile_set, const string& images_folder_path)
+	: m_tile_set{tile_set}, m_load_start{Clock::now()}
+{
+	for (int tile_id = 0; tile_id < tile_set.get_tile_count(); ++tile_id)
+	{
+		const string& base_name = tile_set.get_base_name(tile_id);
+		if (m_slots.try_emplace(base_name, static_cast<int>(m_slot_base_names.size())).second)
+		{
+			m_slot_base_names.push_back(base_name);
+		}
+	}
+
+	if (m_slot_base_names.empty() || load_cached_atlas())
+	{
+		m_is_packed = true;
+		return;
+	}
+
+	start_decoding(images_folder_path);
+}
+
+bool TileAtlas::load_cached_atlas()
+{
+	const std::optional<TileSetCache::AtlasPixels> cached_atlas = m_tile_set.get_cached_atlas();
+
+	// the cache's hash covers the XML and the images, so only check that the layout holds every slot
+	const bool is_cached_atlas_valid = cached_atlas.has_value() && cached_atlas->slot_width > 0 && cached_atlas->slot_height > 0
+		&& cached_atlas->width >= cached_atlas->columns * cached_atlas->slot_width
+		&& cached_atlas->columns * (cached_atlas->height / cached_atlas->slot_height) >= static_cast<int>(m_slot_base_names.size());
+
+	if (!is_cached_atlas_valid)
+	{
+		return false;
+	}
+
+	m_columns = cached_atlas->columns;
+	m_slot_width = cached_atlas->slot_width;
+	m_slot_height = cached_atlas->slot_height;
+	m_atlas_pixels.setFromPixels(cached_atlas->rgba, cached_atlas->width, cached_atlas->height, OF_PIXELS_RGBA);
+
+	return true;
+}
+
+// Decodes <base name>.png for every slot on a thread pool, the last decode packs the atlas
+void TileAtlas::start_decoding(const string& images_folder_path)
+{
+	m_decoded_images.resize(m_slot_base_names.size());
+	m_pending_decodes = static_cast<int>(m_slot_base_names.size());
+	m_decode_pool = std::make_unique<ThreadPool>();
+
+	for (int slot = 0; slot < static_cast<int>(m_slot_base_names.size()); ++slot)
+	{
+		const std::filesystem::path image_path = std::filesystem::path(images_folder_path) / (m_slot_base_names[slot] + ".png");
+
+		m_decode_pool->submit([this, slot, image_path]
+		{
+			// pixels only, textures can only be created on the GL thread
+			if (!ofLoadImage(m_decoded_images[slot], image_path))
+			{
+				std::cerr << "Failed to load tile image: " << image_path << std::endl;
+			}
+
+			if (m_pending_decodes.fetch_sub(1) == 1)
+			{
+				m_load_times.decode_seconds = std::chrono::duration<double>(Clock::now() - m_load_start).count();
+				pack_decoded_images();
+			}
+		});
+	}
+}
+
+// Packs the decoded images into a grid and stores it in the tile set's cache, runs on a decoding thread
+void TileAtlas::pack_decoded_images()
+{
+	const Clock::time_point pack_start = Clock::now();
+
+	// slots are sized after the first image, the others are scaled to match
+	for (const ofPixels& image : m_decoded_images)
+	{
+		if (image.isAllocated())
+		{
+			m_slot_width = static_cast<int>(image.getWidth());
+			m_slot_height = static_cast<int>(image.getHeight());
+			break;
+		}
+	}
+
+	m_columns = static_cast<int>(std::ceil(std::sqrt(m_decoded_images.size())));
+	const int rows = (static_cast<int>(m_decoded_images.size()) + m_columns - 1) / m_columns;
+
+	m_atlas_pixels.allocate(m_columns * m_slot_width, rows * m_slot_height, OF_PIXELS_RGBA);
+	m_atlas_pixels.set(0);
+
+	for (int slot = 0; slot < static_cast<int>(m_decoded_images.size()); ++slot)
+	{
+		ofPixels& image = m_decoded_images[slot];
+		if (!image.isAllocated())
+		{
+			continue;
+		}
+
+		image.setImageType(OF_IMAGE_COLOR_ALPHA);
+		if (image.getWidth() != m_slot_width || image.getHeight() != m_slot_height)
+		{
+			image.resize(m_slot_width, m_slot_height);
+		}
+
+		image.pasteInto(m_atlas_pixels, (slot % m_columns) * m_slot_width, (slot / m_columns) * m_slot_height);
+	}
+	m_decoded_images.clear();
+
+	const TileSetCache::AtlasPixels atlas{static_cast<int>(m_atlas_pixels.getWidth()), static_cast<int>(m_atlas_pixels.getHeight()),
+		m_columns, m_slot_width, m_slot_height, m_atlas_pixels.getData()};
+	m_tile_set.write_cached_atlas(atlas);
+
+	m_load_times.pack_seconds = std::chrono::duration<double>(Clock::now() - pack_start).count();
+	m_is_packed.store(true, std::memory_order_release);
+}
+
+bool TileAtlas::update()
+{
+	if (m_is_loaded || !m_is_packed.load(std::memory_order_acquire))
+	{
+		return m_is_loaded;
+	}
+
+	const Clock::time_point upload_start = Clock::now();
+	if (m_atlas_pixels.isAllocated())
+	{
+		m_texture.loadData(m_atlas_pixels);
+		m_atlas_pixels.clear();
+	}
+	compute_coords();
+	m_load_times.upload_seconds = std::chrono::duration<double>(Clock::now() - upload_start).count();
+
+	m_decode_pool.reset();
+	m_is_loaded = true;
+	return true;
+}
+
+void TileAtlas::compute_coords()
+{
+	m_coords.resize(m_tile_set.get_tile_count());
+	for (int tile_id = 0; tile_id < m_tile_set.get_tile_count(); ++tile_id)
+	{
+		const int slot = m_slots.at(m_tile_set.get_base_name(tile_id));
+
+		// inset by half a texel so linear filtering doesn't bleed in the neighboring slots
+		const float left = (slot % m_columns) * m_slot_width + 0.5f;
+		const float top = (slot / m_columns) * m_slot_height + 0.5f;
+		const float right = left + m_slot_width - 1;
+		const float bottom = top + m_slot_height - 1;
+
+		const QuadCoords corners{
+			m_texture.getCoordFromPoint(left, top),
+			m_texture.getCoordFromPoint(right, top),
+			m_texture.getCoordFromPoint(right, bottom),
+			m_texture.getCoordFromPoint(left, bottom)
+		};
+
+		// rotating the image clockwise by 90 degrees moves each corner's texel one corner clockwise,
+		// so the quad's corner i shows the image's corner i - steps
+		const int steps = m_tile_set.get_rotation(tile_id) / 90;
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			m_coords[tile_id][corner] = corners[(corner - steps + 4) % 4];
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ofMain.h"
+#include "Data/TileSet.h"
+#include "Util/ThreadPool.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+/**
+ * @class TileAtlas
+ * @brief All of a tile set's images packed into one texture. Rotated tiles share their base image,
+ * the rotation is baked into each tile ID's texture coordinates so no per-tile transform is needed when drawing.
+ * Images are decoded into CPU pixels on a thread pool in the background, the texture is uploaded in one go
+ * by update() on the GL thread once they are done, so generation doesn't wait for the images
+ */
+class TileAtlas
+{
+public:
+	// Texture coordinates of a tile's quad corners in the order top-left, top-right, bottom-right, bottom-left
+	using QuadCoords = std::array<glm::vec2, 4>;
+
+	// Wall time of each loading phase, complete once is_loaded()
+	struct LoadTimes {
+		double decode_seconds = 0;
+		double pack_seconds = 0;
+		double upload_seconds = 0;
+	};
+
+	/**
+	 * @brief Takes the packed pixels from the tile set's cache, or starts decoding the base image of every tile
+	 * in the background, packing them into a grid and storing the result in the tile set's cache
+	 * @param images_folder_path Folder with a <base name>.png per tile
+	 */
+	TileAtlas(const TileSet& tile_set, const string& images_folder_path);
+
+	/**
+	 * @brief Uploads the texture once the pixels are ready, call from the GL thread
+	 * @return is_loaded()
+	 */
+	bool update();
+
+	bool is_loaded() const { return m_is_loaded; }
+	const LoadTimes& get_load_times() const { return m_load_times; }
+
+	const ofTexture& get_texture() const { return m_texture; }
+	const QuadCoords& get_coords(const int tile_id) const { return m_coords[tile_id]; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	const TileSet& m_tile_set;
+	// slot of each base name, slots are numbered in tile ID order
+	unordered_map<string, int> m_slots;
+	vector<string> m_slot_base_names;
+
+	ofPixels m_atlas_pixels;
+	int m_columns = 1;
+	int m_slot_width = 1;
+	int m_slot_height = 1;
+	// set by the decoding threads once m_atlas_pixels is packed
+	std::atomic<bool> m_is_packed = false;
+	bool m_is_loaded = false;
+	LoadTimes m_load_times;
+
+	ofTexture m_texture;
+	// m_coords[tile_id]
+	vector<QuadCoords> m_coords;
+
+	vector<ofPixels> m_decoded_images;
+	std::atomic<int> m_pending_decodes = 0;
+	Clock::time_point m_load_start;
+	// destroyed first, waits for the decoding tasks that still use the members above
+	std::unique_ptr<ThreadPool> m_decode_pool;
+
+	bool load_cached_atlas();
+	void start_decoding(const string& images_folder_path);
+	void pack_decoded_images();
+	void compute_coords();
+};
@@ -0,0 +1,167 @@
+#include "TileMapRenderer.h"
+
+#include <algorithm>
+#include <numeric>
+
+TileMapRenderer::TileMapRenderer(const TileSet& tile_set, const string& images_folder_path)
+	: m_atlas{tile_set, images_folder_path}, m_previews{tile_set, m_atlas, PREVIEW_SIZE, PREVIEW_CACHE_BYTES}
+{
+	for (ofVboMesh* mesh : {&m_erase_mesh, &m_mesh, &m_preview_mesh})
+	{
+		mesh->setMode(OF_PRIMITIVE_TRIANGLES);
+		mesh->setUsage(GL_STREAM_DRAW);
+	}
+}
+
+void TileMapRenderer::draw_tile_map(const GenerationWorker::MapSnapshot& snapshot)
+{
+	if (!m_atlas.is_loaded())
+	{
+		if (!m_atlas.update())
+		{
+			// the images are still decoding, the map is drawn in full once they're ready
+			return;
+		}
+
+		const TileAtlas::LoadTimes& load_times = m_atlas.get_load_times();
+		ofLogNotice("TileMapRenderer") << "Tile images loaded: decode " << load_times.decode_seconds << "s, pack "
+			<< load_times.pack_seconds << "s, upload " << load_times.upload_seconds << "s";
+	}
+
+	if (snapshot.sequence == 0)
+	{
+		// the worker didn't publish the first map yet
+		return;
+	}
+
+	if (snapshot.sequence != m_drawn_sequence)
+	{
+		// the dirty cells only cover the changes since dirty_base_sequence
+		const bool is_full_redraw = snapshot.is_fully_dirty || m_drawn_sequence < snapshot.dirty_base_sequence || !m_map_fbo.isAllocated();
+
+		if (is_full_redraw)
+		{
+			allocate_map_fbo(snapshot.width, snapshot.height);
+
+			m_all_cells.resize(snapshot.tiles.size());
+			std::iota(m_all_cells.begin(), m_all_cells.end(), 0);
+			redraw_cells(snapshot, m_all_cells);
+		}
+		else if (!snapshot.dirty_cells.empty())
+		{
+			redraw_cells(snapshot, snapshot.dirty_cells);
+		}
+
+		m_drawn_sequence = snapshot.sequence;
+	}
+
+	ofSetColor(ofColor::white);
+	m_map_fbo.draw(0, 0, snapshot.width * TILE_WIDTH, snapshot.height * TILE_HEIGHT);
+}
+
+// (Re)allocates the FBO for the map size and clears it, called whenever the whole map is redrawn
+void TileMapRenderer::allocate_map_fbo(const int map_width, const int map_height)
+{
+	const int width = std::max(1, map_width);
+	const int height = std::max(1, map_height);
+
+	int max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	m_cell_width = std::min(TILE_WIDTH, std::floor(static_cast<float>(max_texture_size) / width));
+	m_cell_height = std::min(TILE_HEIGHT, std::floor(static_cast<float>(max_texture_size) / height));
+
+	const int fbo_width = static_cast<int>(width * m_cell_width);
+	const int fbo_height = static_cast<int>(height * m_cell_height);
+	if (!m_map_fbo.isAllocated() || m_map_fbo.getWidth() != fbo_width || m_map_fbo.getHeight() != fbo_height)
+	{
+		m_map_fbo.allocate(fbo_width, fbo_height, GL_RGBA);
+	}
+
+	m_map_fbo.begin();
+	ofClear(0, 0, 0, 255);
+	m_map_fbo.end();
+}
+
+// Erases the cells in m_map_fbo and draws their current state, with at most three draw calls
+void TileMapRenderer::redraw_cells(const GenerationWorker::MapSnapshot& snapshot, const vector<int>& cells)
+{
+	m_erase_mesh.clear();
+	m_mesh.clear();
+	m_preview_mesh.clear();
+	m_previews.begin_build();
+
+	for (const int i : cells)
+	{
+		const float x = (i % snapshot.width) * m_cell_width;
+		const float y = (i / snapshot.width) * m_cell_height;
+
+		const ofIndexType first_vertex = m_erase_mesh.getNumVertices();
+		m_erase_mesh.addVertices({{x, y, 0}, {x + m_cell_width, y, 0}, {x + m_cell_width, y + m_cell_height, 0}, {x, y + m_cell_height, 0}});
+		m_erase_mesh.addIndices({first_vertex, first_vertex + 1, first_vertex + 2, first_vertex, first_vertex + 2, first_vertex + 3});
+
+		add_cell(snapshot.tiles[i], x, y);
+	}
+
+	m_map_fbo.begin();
+	ofPushStyle();
+
+	ofSetColor(ofColor::black);
+	m_erase_mesh.draw();
+
+	ofSetColor(ofColor::white);
+	m_previews.get_texture().bind();
+	m_preview_mesh.draw();
+	m_previews.get_texture().unbind();
+
+	m_atlas.get_texture().bind();
+	m_mesh.draw();
+	m_atlas.get_texture().unbind();
+
+	ofPopStyle();
+	m_map_fbo.end();
+}
+
+void TileMapRenderer::add_cell(const Tile& tile, const float x, const float y)
+{
+	if (const std::optional<int> tile_id = tile.get_collapsed_id(); tile_id.has_value()) {
+		add_quad(m_mesh, x, y, m_atlas.get_coords(tile_id.value()), ofFloatColor::white);
+	}
+	else if (tile.is_domain_empty()) {
+		return;
+	}
+	else if (const std::optional<TileAtlas::QuadCoords> preview = m_previews.get_preview(tile.domain); preview.has_value()) {
+		add_quad(m_preview_mesh, x, y, preview.value(), ofFloatColor::white);
+	}
+	else {
+		// more distinct superpositions in this redraw than the cache holds
+		add_multiple_possibilities(tile, x, y);
+	}
+}
+
+/**
+ * superimpose all possibilities with transparency
+ */
+void TileMapRenderer::add_multiple_possibilities(const Tile& tile, const float x, const float y)
+{
+	const ofFloatColor color(1, 1, 1, 1.0f / tile.possible_tile_count);
+
+	tile.domain.for_each([&](const int possibility_id) {
+		add_quad(m_mesh, x, y, m_atlas.get_coords(possibility_id), color);
+	});
+}
+
+// Appends a cell sized quad, the coordinates already have the tile's rotation applied
+void TileMapRenderer::add_quad(ofVboMesh& mesh, const float x, const float y, const TileAtlas::QuadCoords& coords, const ofFloatColor& color) const
+{
+	const ofIndexType first_vertex = mesh.getNumVertices();
+	const glm::vec3 corners[4]{{x, y, 0}, {x + m_cell_width, y, 0}, {x + m_cell_width, y + m_cell_height, 0}, {x, y + m_cell_height, 0}};
+
+	for (int corner = 0; corner < 4; ++corner)
+	{
+		mesh.addVertex(corners[corner]);
+		mesh.addTexCoord(coords[corner]);
+		mesh.addColor(color);
+	}
+
+	mesh.addIndices({first_vertex, first_vertex + 1, first_vertex + 2, first_vertex, first_vertex + 2, first_vertex + 3});
+}
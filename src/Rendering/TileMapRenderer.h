@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ofMain.h"
+#include "Data/TileSet.h"
+#include "Generation/GenerationWorker.h"
+#include "Rendering/SuperpositionCache.h"
+#include "Rendering/TileAtlas.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @class TileMapRenderer
+ * @brief Draws the map snapshots published by a GenerationWorker with openFrameworks.
+ * The map is kept in a persistent FBO, each new snapshot only redraws its dirty cells into it:
+ * collapsed cells textured from the tile set's atlas, uncollapsed cells from cached superposition previews.
+ * Holds the images so that the solver itself doesn't depend on openFrameworks
+ */
+class TileMapRenderer
+{
+public:
+	/**
+	 * @brief Constructs a renderer by loading the tile set's images into an atlas
+	 * @param images_folder_path Path to the folder containing tile images.
+	 */
+	TileMapRenderer(const TileSet& tile_set, const string& images_folder_path);
+
+	/**
+	 * @brief Redraws the snapshot's dirty cells and draws the map. The whole map is redrawn when the dirty cells don't
+	 * reach back to the snapshot drawn last, e.g. while the tile images were loading. Draws nothing until they finished loading
+	 */
+	void draw_tile_map(const GenerationWorker::MapSnapshot& snapshot);
+
+private:
+	static constexpr float TILE_WIDTH = 60;
+	static constexpr float TILE_HEIGHT = 60;
+
+	static constexpr int PREVIEW_SIZE = 64;
+	static constexpr size_t PREVIEW_CACHE_BYTES = 64 * 1024 * 1024;
+
+	TileAtlas m_atlas;
+	SuperpositionCache m_previews;
+
+	ofFbo m_map_fbo;
+	// size of a cell in m_map_fbo, smaller than the tile size when the map wouldn't fit the maximum texture size
+	float m_cell_width = TILE_WIDTH;
+	float m_cell_height = TILE_HEIGHT;
+	// sequence of the snapshot m_map_fbo shows, 0 if none
+	uint64_t m_drawn_sequence = 0;
+	vector<int> m_all_cells;
+
+	// per redraw: black quads erasing the redrawn cells, collapsed cells, uncollapsed cells
+	ofVboMesh m_erase_mesh;
+	ofVboMesh m_mesh;
+	ofVboMesh m_preview_mesh;
+
+	void allocate_map_fbo(int map_width, int map_height);
+	void redraw_cells(const GenerationWorker::MapSnapshot& snapshot, const vector<int>& cells);
+	void add_cell(const Tile& tile, float x, float y);
+	void add_multiple_possibilities(const Tile& tile, float x, float y);
+	void add_quad(ofVboMesh& mesh, float x, float y, const TileAtlas::QuadCoords& coords, const ofFloatColor& color) const;
+};
@@ -1,333 +1,1104 @@
 #include "TileMapGenerator.h"
 
-#include "ofMain.h"
-
-TileMapGenerator::TileMapGenerator(const TileSet& tile_set) : m_tile_set{tile_set}
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "Util/DomainKernels.h"
+
+template <typename DomainWords, typename Topology>
+BasicTileMapGenerator<DomainWords, Topology>::BasicTileMapGenerator(const TileSet& tile_set, const PropagatorType propagator)
+	: m_tile_set{tile_set}, m_adjacency{*tile_set.adjacency}, m_propagator{propagator},
+	m_words{Domain::words_for(tile_set.get_tile_count())}, m_tile_count{tile_set.get_tile_count()},
+	m_random{std::random_device{}()}, m_tile_weights{tile_set}, m_mask_union{*tile_set.adjacency}
 {
-	std::srand(static_cast<unsigned int>(std::time(nullptr)));
+	const Domain full_domain = tile_set.get_full_domain();
+	m_full_domain.assign(full_domain.words(), full_domain.words() + word_count());
+	m_allowed.resize(word_count());
 
-	for (const string& tile_name : m_tile_set.adjacency | std::views::keys)
+	// summed in tile ID order, the entropies depend on the order to the last bit
+	for (int tile_id = 0; tile_id < m_tile_count; ++tile_id)
 	{
-		m_all_tile_names.insert(tile_name);
+		m_full_weight_sum += tile_set.get_weight(tile_id);
+		m_full_weight_log_weight_sum += tile_set.get_weight_log_weight(tile_id);
 	}
+
+	m_supported_tiles.assign(static_cast<size_t>(Topology::SIDE_COUNT) * word_count(), 0);
+	for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+	{
+		uint64_t* supported = m_supported_tiles.data() + static_cast<size_t>(side) * word_count();
+		for (int tile_id = 0; tile_id < m_tile_count; ++tile_id)
+		{
+			if (m_adjacency.get_support_count(tile_id, side) > 0)
+			{
+				supported[tile_id / Domain::BITS_PER_WORD] |= uint64_t{1} << (tile_id % Domain::BITS_PER_WORD);
+			}
+			else
+			{
+				m_has_unsupported_tiles = true;
+			}
+		}
+	}
+}
+
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::set_seed(const uint64_t seed)
+{
+	m_random.seed(seed);
+}
+
+template <typename DomainWords, typename Topology>
+Tile BasicTileMapGenerator<DomainWords, Topology>::get_tile(const int idx) const
+{
+	Domain domain(m_tile_count);
+	std::copy_n(get_domain(idx), domain.word_count(), domain.words());
+
+	return Tile{domain, m_weight_sums[idx], m_weight_log_weight_sums[idx]};
 }
 
-void TileMapGenerator::generate_tile_map(const int width, const int height)
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationResult BasicTileMapGenerator<DomainWords, Topology>::generate_tile_map(const int width, const int height, const int depth)
 {
-	init_tile_map(width, height);
+	init_tile_map(width, height, depth);
 	
-	while (!is_tile_map_finished)
+	while (!is_tile_map_finished())
 	{
 		generate_single_step();
 	}
+
+	return m_result;
 }
 
-void TileMapGenerator::init_tile_map(const int width, const int height)
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::init_tile_map(const int width, const int height, const int depth)
 {
+	m_topology.resize(width, height, depth);
+
+	// pins are cell indices, which only stay valid for the same size
+	if (width != m_output_width || height != m_output_height || m_topology.get_depth() != m_output_depth || m_pinned_tiles.empty())
+	{
+		m_pinned_tiles.assign(m_topology.get_cell_count(), -1);
+		m_pinned_cells.clear();
+	}
+
 	m_output_width = width;
 	m_output_height = height;
+	m_output_depth = m_topology.get_depth();
 
-	m_tile_map = vector(width * height, Tile{m_all_tile_names});
-	is_tile_map_finished = false;
+	m_stats.reset();
+	m_backtrack_count = 0;
+	m_restart_count = 0;
+
+	m_region_cells.clear();
+	reset_tile_map();
+}
+
+// Sets the cell to the full domain, a cell that can still be any of the set's tiles
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::reset_cell(const int idx)
+{
+	std::copy(m_full_domain.begin(), m_full_domain.end(), get_domain(idx));
+	m_possible_tile_counts[idx] = m_tile_count;
+	m_weight_sums[idx] = m_full_weight_sum;
+	m_weight_log_weight_sums[idx] = m_full_weight_log_weight_sum;
 }
 
-void TileMapGenerator::generate_single_step()
+// Resets every cell to the full domain, keeps the size, random state and counters
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::reset_tile_map()
 {
-	if (is_tile_map_finished)
+	const int cell_count = m_topology.get_cell_count();
+	m_domains.resize(static_cast<size_t>(cell_count) * word_count());
+	m_possible_tile_counts.resize(cell_count);
+	m_weight_sums.resize(cell_count);
+	m_weight_log_weight_sums.resize(cell_count);
+	for (int idx = 0; idx < cell_count; ++idx)
 	{
-		return;
+		reset_cell(idx);
 	}
 
-	// pick the lowest entropy cell
-	int idx_to_collapse = get_next_cell_to_collapse(m_tile_map);
+	m_remaining_cells = m_tile_count == 1 ? 0 : cell_count;
+	m_result = GenerationResult{};
 
-	// collapse cell
-	collapse_cell(idx_to_collapse);
+	m_is_recording_trail = m_backtracking.is_enabled;
+	m_trail.clear();
+	m_decisions.clear();
+	m_attempt_backtrack_count = 0;
 
-	QueueEntry collapsed_cell = QueueEntry{m_tile_map[idx_to_collapse],idx_to_collapse};
+	m_touched_cells.clear();
+	m_is_touched.assign(cell_count, false);
+	m_dirty_cells.clear();
+	m_is_dirty.assign(cell_count, false);
+	m_is_fully_dirty = true;
+	m_is_in_region.assign(cell_count, false);
+	m_is_selecting_region = false;
 
-	// propagate constraints
-	std::deque<QueueEntry> tiles_to_update_queue{collapsed_cell};
-	recalculate_constraints(m_tile_map, tiles_to_update_queue);
+	m_update_queue.clear();
+	if (m_propagator == PropagatorType::SupportCount)
+	{
+		init_support_count();
+	}
+	else if (m_has_unsupported_tiles)
+	{
+		for (int idx = 0; idx < cell_count; ++idx)
+		{
+			prune_unsupported_tiles(idx);
+		}
+	}
 
-	int remaining_cells = count_remaining_cells(m_tile_map);
-	is_tile_map_finished = remaining_cells <= 0;
+	apply_pins(m_pinned_cells);
+	propagate_queued();
+
+	init_entropy_heap();
+	update_finished_status();
 }
 
-int TileMapGenerator::get_next_cell_to_collapse(TileMap& cells) const
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::init_entropy_heap()
 {
-	float minimal_value = std::numeric_limits<int>::max();
-	std::optional<int> minimal_cell_idx;
+	constexpr double MAX_NOISE = 1e-6;
 
-	for (int i = 0; i < cells.size(); ++i)
+	m_entropy_noise.resize(get_cell_count());
+	for (double& noise : m_entropy_noise)
 	{
-		Tile& cell = cells[i];
+		noise = random_unit(m_random) * MAX_NOISE;
+	}
 
-		if (cell.is_collapsed()) {
+	build_entropy_heap();
+}
+
+// Rebuilds the heap from every cell that can still collapse, with the cells' current noise
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::build_entropy_heap()
+{
+	vector<EntropyEntry> entries;
+	entries.reserve(get_cell_count());
+
+	m_entropy.resize(get_cell_count());
+	for (int idx = 0; idx < get_cell_count(); ++idx)
+	{
+		if (m_possible_tile_counts[idx] > 1)
+		{
+			m_entropy[idx] = get_cell_entropy(idx);
+			entries.push_back(EntropyEntry{m_entropy[idx], idx});
+		}
+	}
+
+	// heapify all cells at once, O(N)
+	m_entropy_heap = EntropyHeap(std::greater<>(), std::move(entries));
+
+	for (const int idx : m_touched_cells)
+	{
+		m_is_touched[idx] = false;
+	}
+	m_touched_cells.clear();
+}
+
+// Pushes an up to date heap entry for every cell whose domain changed, older entries become stale
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::push_touched_cells()
+{
+	for (const int idx : m_touched_cells)
+	{
+		m_is_touched[idx] = false;
+
+		if (m_possible_tile_counts[idx] <= 1)
+		{
 			continue;
 		}
 
-		float cell_entropy = compute_cell_entropy(cell);
-		if (cell_entropy < minimal_value)
+		// kept up to date outside the selected region as well, the region's heap entries are compared against it
+		m_entropy[idx] = get_cell_entropy(idx);
+		if (!m_is_selecting_region || m_is_in_region[idx])
 		{
-			minimal_cell_idx = i;
-			minimal_value = cell_entropy;
+			m_entropy_heap.push(EntropyEntry{m_entropy[idx], idx});
 		}
 	}
 
-	if (!minimal_cell_idx.has_value())
+	m_touched_cells.clear();
+}
+
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::init_support_count()
+{
+	m_support_count.assign(static_cast<size_t>(get_cell_count()) * Topology::SIDE_COUNT * m_tile_count, 0);
+	m_ban_stack.clear();
+
+	for (int idx = 0; idx < get_cell_count(); ++idx)
 	{
-		std::cerr << "No cell to collapse" << std::endl;
-		throw std::exception();
+		for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+		{
+			const bool has_neighbor = m_topology.get_neighbor(idx, side) != Topology::NO_NEIGHBOR;
+
+			for (int tile_id = 0; tile_id < m_tile_count; ++tile_id)
+			{
+				// every tile allowed on this side is still possible in the neighbor
+				const int support = m_adjacency.get_support_count(tile_id, side);
+				m_support_count[get_support_idx(idx, side, tile_id)] = support;
+
+				if (has_neighbor && support == 0 && is_possible(idx, tile_id))
+				{
+					ban_tile(idx, tile_id);
+				}
+			}
+		}
 	}
 
-	return minimal_cell_idx.value();
+	// tiles without any possible neighbor on an inner side were banned above
+	propagate_support_count();
 }
 
-float TileMapGenerator::compute_cell_entropy(const Tile& cell) const
+/**
+ * Bans the cell's tiles that no tile allows next to them on a side where the cell has a neighbor, which
+ * init_support_count does for the support count propagator, and queues the cell for the domain scan if it changed
+ */
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::prune_unsupported_tiles(const int idx)
 {
-	float entropy = 0;
-	for (const auto& tile_name : cell.domain)
+	const int* neighbors = m_topology.get_neighbors(idx);
+	bool is_changed = false;
+
+	for (int side = 0; side < Topology::SIDE_COUNT; ++side)
 	{
-		float w = m_tile_set.get_weight(tile_name);
-		entropy -= w * log2(w);
+		if (neighbors[side] != Topology::NO_NEIGHBOR)
+		{
+			is_changed |= update_neighbor_domain(idx, m_supported_tiles.data() + static_cast<size_t>(side) * word_count());
+		}
 	}
 
-	return entropy;
+	if (is_changed)
+	{
+		m_update_queue.push_back(idx);
+	}
 }
 
-void TileMapGenerator::collapse_cell(const int idx)
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationResult BasicTileMapGenerator<DomainWords, Topology>::generate_single_step()
 {
-	Tile& tile = m_tile_map[idx];
+	if (is_tile_map_finished())
+	{
+		return m_result;
+	}
+
+	Clock::time_point phase_start = start_phase();
+
+	// pick the lowest entropy cell
+	int idx_to_collapse = get_next_cell_to_collapse();
+	if (idx_to_collapse == NO_CELL)
+	{
+		return m_result;
+	}
+	end_phase(m_stats.get_current_step().selection_seconds, phase_start);
+
+	// collapse cell
+	const size_t trail_size = m_trail.size();
+	const int selected_tile = collapse_cell(idx_to_collapse);
+	if (m_is_recording_trail)
+	{
+		m_decisions.push_back(Decision{idx_to_collapse, selected_tile, trail_size});
+	}
+	end_phase(m_stats.get_current_step().collapse_seconds, phase_start);
+
+	// propagate constraints
+	propagate(idx_to_collapse);
+	if (m_stats.is_enabled())
+	{
+		GenerationStats::StepStats& step = m_stats.get_current_step();
+		step.collapsed_idx = idx_to_collapse;
+		step.is_contradiction = is_contradiction();
+	}
+	if (is_contradiction() && m_is_recording_trail)
+	{
+		backtrack();
+	}
+	if (m_stats.is_enabled())
+	{
+		m_stats.get_current_step().cells_touched = static_cast<int>(m_touched_cells.size());
+	}
+	push_touched_cells();
+	end_phase(m_stats.get_current_step().propagation_seconds, phase_start);
+	if (m_stats.is_enabled())
+	{
+		m_stats.end_step();
+	}
 
-	string selected_tile = random_domain_tile(tile);
+	update_finished_status();
+	return m_result;
+}
+
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationProgress BasicTileMapGenerator<DomainWords, Topology>::generate_steps(const int step_count)
+{
+	GenerationProgress progress;
+	while (progress.steps < step_count && !is_tile_map_finished())
+	{
+		generate_single_step();
+		progress.steps++;
+	}
 
-	tile.domain.clear();
-	tile.domain.insert(selected_tile);
+	progress.result = m_result;
+	progress.remaining_cells = m_remaining_cells;
+	return progress;
 }
 
-string TileMapGenerator::random_domain_tile(const Tile& tile) const
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationProgress BasicTileMapGenerator<DomainWords, Topology>::generate_for(const std::chrono::microseconds budget)
 {
-	vector<std::pair<string, float>> tile_weights;
-	float total_weight = 0;
-	for (const auto& cell : tile.domain)
+	const Clock::time_point deadline = Clock::now() + budget;
+
+	GenerationProgress progress;
+	while (!is_tile_map_finished() && (progress.steps == 0 || Clock::now() < deadline))
 	{
-		float weight = m_tile_set.get_weight(cell);
+		generate_single_step();
+		progress.steps++;
+	}
+
+	progress.result = m_result;
+	progress.remaining_cells = m_remaining_cells;
+	return progress;
+}
 
-		total_weight += weight;
-		tile_weights.emplace_back(cell, weight);
+// Adds the time since phase_start to phase_seconds and starts the next phase, no-op unless stats are enabled
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::end_phase(double& phase_seconds, Clock::time_point& phase_start) const
+{
+	if (!m_stats.is_enabled())
+	{
+		return;
 	}
 
-	float random_value = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX) + 1.0f);
-	random_value *= total_weight;
+	const Clock::time_point now = Clock::now();
+	phase_seconds += std::chrono::duration<double>(now - phase_start).count();
+	phase_start = now;
+}
+
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::update_finished_status()
+{
+	if (m_result.status == GenerationStatus::InProgress && m_remaining_cells <= 0)
+	{
+		m_result.status = GenerationStatus::Finished;
+	}
+}
 
-	float cumulative = 0;
-	int selected_i = 0;
-	for (int i = 0; i < tile_weights.size(); ++i)
+template <typename DomainWords, typename Topology>
+int BasicTileMapGenerator<DomainWords, Topology>::get_next_cell_to_collapse()
+{
+	while (true)
 	{
-		cumulative += tile_weights[i].second / total_weight;
-		if (random_value < cumulative)
+		while (!m_entropy_heap.empty())
+		{
+			const EntropyEntry entry = m_entropy_heap.top();
+			m_entropy_heap.pop();
+
+			if (m_possible_tile_counts[entry.idx] <= 1 || entry.entropy != m_entropy[entry.idx])
+			{
+				// stale entry, a newer one was pushed when the cell's domain changed
+				continue;
+			}
+
+			return entry.idx;
+		}
+
+		if (!m_is_selecting_region)
 		{
-			selected_i = i;
 			break;
 		}
+
+		// the region is solved, the rest of the unfinished map is next
+		end_region_selection();
 	}
 
-	return tile_weights[selected_i].first;
+	// cells remain but none has a valid entry, e.g. NaN entropies of tiles weighted 0
+	m_result.status = GenerationStatus::Contradiction;
+	return NO_CELL;
 }
 
-void TileMapGenerator::recalculate_constraints(TileMap& cells, std::deque<QueueEntry>& tiles_to_update_queue)
+// Returns the selected tile ID
+template <typename DomainWords, typename Topology>
+int BasicTileMapGenerator<DomainWords, Topology>::collapse_cell(const int idx)
 {
-	// propagate constraints: update cell's domain & add neighbors if changed
-	while (!tiles_to_update_queue.empty())
+	const int selected_tile = random_domain_tile(idx);
+
+	for_each_possible_tile(idx, [&](const int tile_id)
 	{
-		auto [tile, idx] = tiles_to_update_queue.front();
-		tiles_to_update_queue.pop_front();
+		if (tile_id != selected_tile)
+		{
+			ban_tile(idx, tile_id);
+		}
+	});
 
-		std::deque<QueueEntry> changed_tiles = update_neighbors_domain(idx, cells);
+	return selected_tile;
+}
+
+/**
+ * Removes tile_id from the cell's domain. With the support count propagator the removal is
+ * also recorded so its support can be withdrawn from the neighbors in propagate_support_count
+ */
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::ban_tile(const int idx, const int tile_id)
+{
+	get_domain(idx)[tile_id / Domain::BITS_PER_WORD] &= ~(uint64_t{1} << (tile_id % Domain::BITS_PER_WORD));
+	const int possible_tile_count = --m_possible_tile_counts[idx];
+	m_weight_sums[idx] -= m_tile_set.get_weight(tile_id);
+	m_weight_log_weight_sums[idx] -= m_tile_set.get_weight_log_weight(tile_id);
 
-		tiles_to_update_queue.insert(tiles_to_update_queue.end(), changed_tiles.begin(), changed_tiles.end());
-		changed_tiles.clear();
+	touch_cell(idx);
+	if (m_stats.is_enabled())
+	{
+		m_stats.on_tile_banned();
+	}
+
+	if (possible_tile_count == 1)
+	{
+		m_remaining_cells--;
+	}
+	else if (possible_tile_count == 0 && !is_contradiction())
+	{
+		m_result.status = GenerationStatus::Contradiction;
+		m_result.contradiction_idx = idx;
+	}
+
+	if (m_propagator == PropagatorType::SupportCount)
+	{
+		m_ban_stack.push_back(BanEntry{idx, tile_id});
+	}
+
+	if (m_is_recording_trail)
+	{
+		m_trail.push_back(TrailEntry{idx, tile_id, TrailEntry::Action::Ban});
 	}
 }
 
-std::deque<TileMapGenerator::QueueEntry> TileMapGenerator::update_neighbors_domain(const int idx, TileMap& cells)
+// Records that the cell's domain changed, for the entropy heap and for drain_dirty_cells
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::touch_cell(const int idx)
 {
-	const Tile& tile = cells[idx];
-	std::deque<QueueEntry> changed_tiles;
+	if (!m_is_touched[idx])
+	{
+		m_is_touched[idx] = true;
+		m_touched_cells.push_back(idx);
+	}
 
-	for (int side = 0; side < TileSet::NUMBER_OF_SIDES; ++side)
+	if (!m_is_dirty[idx])
 	{
-		if (const std::optional<int> neighbor_idx = get_neighbor_idx(idx, side); neighbor_idx.has_value()
-		&& update_neighbor_domain(tile, cells[neighbor_idx.value()], TileSet::opposite_side(side)))
-		{
-			changed_tiles.push_back(QueueEntry{cells[neighbor_idx.value()], neighbor_idx.value()});
-		}
+		m_is_dirty[idx] = true;
+		m_dirty_cells.push_back(idx);
 	}
+}
 
-	return changed_tiles;
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::pin_cell(const int idx, const int tile_id)
+{
+	if (m_pinned_tiles[idx] < 0)
+	{
+		m_pinned_cells.push_back(idx);
+	}
+	m_pinned_tiles[idx] = tile_id;
 }
 
-bool TileMapGenerator::update_neighbor_domain(const Tile& current_tile, Tile& neighbor, const int direction_from_neighbor)
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::unpin_cell(const int idx)
 {
-	if (neighbor.domain.size() == 1)
+	if (m_pinned_tiles[idx] < 0)
 	{
-		return false;
+		return;
 	}
 
-	std::deque<string> unsupported_neighbor_tiles;
-	for (const auto& neighbor_tile_name : neighbor.domain)
+	m_pinned_tiles[idx] = -1;
+	std::erase(m_pinned_cells, idx);
+}
+
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::clear_pins()
+{
+	for (const int idx : m_pinned_cells)
 	{
-		unordered_set<string> neighbor_adjacency_rules = m_tile_set.adjacency.at(neighbor_tile_name)[direction_from_neighbor];
-		bool is_supported = false;
+		m_pinned_tiles[idx] = -1;
+	}
+	m_pinned_cells.clear();
+}
 
-		for (auto& allowed_neighbor : neighbor_adjacency_rules)
+// Bans every tile but the pinned one in the given cells that are pinned, and queues them for the domain scan propagator
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::apply_pins(const vector<int>& cells)
+{
+	for (const int idx : cells)
+	{
+		const int pinned_tile = m_pinned_tiles[idx];
+		if (pinned_tile < 0)
 		{
-			if (current_tile.domain.contains(allowed_neighbor))
+			continue;
+		}
+
+		// a pinned tile that isn't possible here leaves the domain empty, a contradiction
+		for_each_possible_tile(idx, [&](const int tile_id)
+		{
+			if (tile_id != pinned_tile)
 			{
-				is_supported = true;
-				break;
+				ban_tile(idx, tile_id);
 			}
+		});
+
+		if (m_propagator == PropagatorType::DomainScan)
+		{
+			m_update_queue.push_back(idx);
+		}
+	}
+}
+
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationResult BasicTileMapGenerator<DomainWords, Topology>::reset_region(const vector<int>& region_cells)
+{
+	if (region_cells.empty())
+	{
+		return m_result;
+	}
+
+	// the flags of the last region if it wasn't solved yet
+	end_region_selection(false);
+	m_region_cells = region_cells;
+
+	m_stats.reset();
+	m_backtrack_count = 0;
+	m_restart_count = 0;
+
+	reset_region_cells();
+	return m_result;
+}
+
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationResult BasicTileMapGenerator<DomainWords, Topology>::reset_region(const int x, const int y, const int width, const int height)
+{
+	const int first_col = std::max(x, 0), last_col = std::min(x + width, m_output_width);
+	const int first_row = std::max(y, 0), last_row = std::min(y + height, m_output_height);
+
+	vector<int> region_cells;
+	for (int row = first_row; row < last_row; ++row)
+	{
+		for (int col = first_col; col < last_col; ++col)
+		{
+			region_cells.push_back(row * m_output_width + col);
 		}
+	}
+
+	return reset_region(region_cells);
+}
+
+template <typename DomainWords, typename Topology>
+TileMapGeneratorBase::GenerationResult BasicTileMapGenerator<DomainWords, Topology>::regenerate_region(const int x, const int y, const int width, const int height)
+{
+	reset_region(x, y, width, height);
+
+	while (!is_tile_map_finished())
+	{
+		generate_single_step();
+	}
+
+	return m_result;
+}
+
+// Resets the cells of m_region_cells, see reset_region. Like reset_tile_map keeps the random state and counters
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::reset_region_cells()
+{
+	m_result = GenerationResult{};
+
+	m_is_recording_trail = m_backtracking.is_enabled;
+	m_trail.clear();
+	m_decisions.clear();
+	m_attempt_backtrack_count = 0;
+	m_ban_stack.clear();
+	m_update_queue.clear();
 
-		if (!is_supported)
+	// only the region's cells are selected until it's solved, on a finished map that keeps selection proportional
+	// to the region. The cells outside keep their domains, an unfinished map's heap is rebuilt after the region
+	m_entropy_heap = EntropyHeap();
+	m_is_selecting_region = true;
+
+	for (const int idx : m_region_cells)
+	{
+		m_is_in_region[idx] = true;
+
+		// collapsed and empty cells weren't counted as remaining
+		if (m_tile_count != 1 && m_possible_tile_counts[idx] <= 1)
 		{
-			unsupported_neighbor_tiles.push_back(neighbor_tile_name);
+			m_remaining_cells++;
 		}
+		reset_cell(idx);
+		touch_cell(idx);
 	}
 
-	for (const auto& unsupported_tile : unsupported_neighbor_tiles)
+	if (m_propagator == PropagatorType::SupportCount)
 	{
-		neighbor.domain.erase(unsupported_tile);
+		init_region_support_count();
+	}
+	else
+	{
+		// the cells bordering the region filter its domains, the region's changed cells their neighbors in turn
+		for (const int idx : m_region_cells)
+		{
+			const int* neighbors = m_topology.get_neighbors(idx);
+			for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+			{
+				if (neighbors[side] != Topology::NO_NEIGHBOR && !m_is_in_region[neighbors[side]])
+				{
+					m_update_queue.push_back(neighbors[side]);
+				}
+			}
+		}
+
+		if (m_has_unsupported_tiles)
+		{
+			for (const int idx : m_region_cells)
+			{
+				prune_unsupported_tiles(idx);
+			}
+		}
 	}
 
-	return neighbor.domain.size() == 1;
+	apply_pins(m_region_cells);
+	propagate_queued();
+
+	push_touched_cells();
+	update_finished_status();
 }
 
 /**
- * Returns the number of cells with multiple tile possibilities
- * @return The number above or 0 if any cell was found with domain.size() == 0 (invalid output)
+ * Support counts of the region's cells: on sides facing a cell that was reset too they're the full counts, as in
+ * init_support_count, on sides facing a cell bordering the region they're counted from that cell's domain.
+ * The bordering cell in turn gets the full counts from the reset cell's side. Tiles left without support are banned
  */
-int TileMapGenerator::count_remaining_cells(const TileMap& cells)
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::init_region_support_count()
 {
-	int remaining_cells = 0;
-	for (auto& cell : cells)
+	const int tile_count = m_tile_count;
+
+	for (const int idx : m_region_cells)
 	{
-		if (cell.is_domain_empty())
+		const int* neighbors = m_topology.get_neighbors(idx);
+		for (int side = 0; side < Topology::SIDE_COUNT; ++side)
 		{
-			return 0;
+			const int neighbor_idx = neighbors[side];
+			int* support = &m_support_count[get_support_idx(idx, side, 0)];
+
+			if (neighbor_idx == Topology::NO_NEIGHBOR || m_is_in_region[neighbor_idx])
+			{
+				for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+				{
+					support[tile_id] = m_adjacency.get_support_count(tile_id, side);
+				}
+				continue;
+			}
+
+			// each of the bordering cell's tiles supports the tiles it allows on its side facing the region
+			const int direction_from_neighbor = TileSet::opposite_side(side, Topology::SIDE_COUNT);
+			std::fill_n(support, tile_count, 0);
+			for_each_possible_tile(neighbor_idx, [&](const int neighbor_tile_id)
+			{
+				m_adjacency.for_each_allowed(neighbor_tile_id, direction_from_neighbor, [&](const int tile_id)
+				{
+					support[tile_id]++;
+				});
+			});
+
+			int* neighbor_support = &m_support_count[get_support_idx(neighbor_idx, direction_from_neighbor, 0)];
+			for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+			{
+				neighbor_support[tile_id] = m_adjacency.get_support_count(tile_id, direction_from_neighbor);
+			}
 		}
+	}
 
-		if (!cell.is_collapsed())
+	for (const int idx : m_region_cells)
+	{
+		for (int side = 0; side < Topology::SIDE_COUNT; ++side)
 		{
-			remaining_cells++;
+			if (m_topology.get_neighbor(idx, side) == Topology::NO_NEIGHBOR)
+			{
+				continue;
+			}
+
+			for (int tile_id = 0; tile_id < tile_count; ++tile_id)
+			{
+				if (m_support_count[get_support_idx(idx, side, tile_id)] == 0 && is_possible(idx, tile_id))
+				{
+					ban_tile(idx, tile_id);
+				}
+			}
 		}
 	}
+}
+
+// Lets the cells outside the region be selected again, and rebuilds the heap for them if asked to
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::end_region_selection(const bool is_rebuilding_heap)
+{
+	if (!m_is_selecting_region)
+	{
+		return;
+	}
+
+	for (const int idx : m_region_cells)
+	{
+		m_is_in_region[idx] = false;
+	}
+	m_is_selecting_region = false;
 
-	return remaining_cells;
+	if (is_rebuilding_heap)
+	{
+		build_entropy_heap();
+	}
 }
 
-std::optional<int> TileMapGenerator::get_idx(const int row, const int col) const
+// Starts the generation over after a contradiction: the last reset region again, or else the whole map
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::restart()
 {
-	if (row < 0 || row >= m_output_height || col < 0 || col >= m_output_width)
+	m_restart_count++;
+
+	if (m_region_cells.empty())
 	{
-		return std::nullopt;
+		reset_tile_map();
+		return;
 	}
-	return row * m_output_width + col;
+
+	reset_region_cells();
 }
 
-std::optional<int> TileMapGenerator::get_neighbor_idx(const int idx, const int side) const
+/**
+ * Undoes decisions until banning the failed tile of the last undone decision no longer contradicts.
+ * Restarts the map when a backtracking limit is hit, and gives up, keeping the contradiction,
+ * when no decision is left to undo or the restarts ran out
+ */
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::backtrack()
 {
-	const auto [row, col] = get_coord(idx);
+	int depth = 0;
 
-	switch (side)
+	while (is_contradiction())
 	{
-	case TileSet::TOP_SIDE_IDX:
-		return get_idx(row - 1, col);
+		if (m_decisions.empty())
+		{
+			// the contradiction follows from the tile set alone, restarting can't help
+			return;
+		}
 
-	case TileSet::RIGHT_SIDE_IDX:
-		return get_idx(row, col + 1);
+		if (depth >= m_backtracking.max_depth || m_attempt_backtrack_count >= m_backtracking.max_backtracks)
+		{
+			if (m_restart_count < m_backtracking.max_restarts)
+			{
+				restart();
+			}
+			return;
+		}
+
+		const Decision decision = m_decisions.back();
+		m_decisions.pop_back();
+		undo_trail(decision.trail_size);
+		depth++;
+		m_backtrack_count++;
+		m_attempt_backtrack_count++;
+
+		// the decision's cell can't be its selected tile, which is a removal of the previous decision
+		m_result = GenerationResult{};
+		m_ban_stack.clear();
+		ban_tile(decision.idx, decision.tile_id);
+		propagate(decision.idx);
+	}
+}
+
+// Pops and reverts trail entries until the trail has trail_size entries
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::undo_trail(const size_t trail_size)
+{
+	while (m_trail.size() > trail_size)
+	{
+		const TrailEntry entry = m_trail.back();
+		m_trail.pop_back();
+
+		if (entry.action == TrailEntry::Action::WithdrawSupport)
+		{
+			restore_support(entry.idx, entry.tile_id);
+			continue;
+		}
+
+		if (is_collapsed(entry.idx))
+		{
+			m_remaining_cells++;
+		}
+		add_possible_tile(entry.idx, entry.tile_id);
+	}
+}
 
-	case TileSet::BOTTOM_SIDE_IDX:
-		return get_idx(row + 1, col);
+// Adds a banned tile back to the cell's domain and its weight to the running sums, undoes ban_tile's removal
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::add_possible_tile(const int idx, const int tile_id)
+{
+	get_domain(idx)[tile_id / Domain::BITS_PER_WORD] |= uint64_t{1} << (tile_id % Domain::BITS_PER_WORD);
+	m_possible_tile_counts[idx]++;
+	m_weight_sums[idx] += m_tile_set.get_weight(tile_id);
+	m_weight_log_weight_sums[idx] += m_tile_set.get_weight_log_weight(tile_id);
+	touch_cell(idx);
+}
 
-	case TileSet::LEFT_SIDE_IDX:
-		return get_idx(row, col - 1);
+// Gives back the support a banned tile withdrew from its neighbors in propagate_support_count
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::restore_support(const int idx, const int tile_id)
+{
+	for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+	{
+		if (const int neighbor_idx = m_topology.get_neighbor(idx, side); neighbor_idx != Topology::NO_NEIGHBOR)
+		{
+			const int direction_from_neighbor = TileSet::opposite_side(side, Topology::SIDE_COUNT);
+			m_adjacency.for_each_allowed(tile_id, side, [&](const int neighbor_tile_id)
+			{
+				m_support_count[get_support_idx(neighbor_idx, direction_from_neighbor, neighbor_tile_id)]++;
+			});
+		}
+	}
+}
 
-	default:
+// Samples a tile of the domain by weight, uses the tile set's alias table while the cell can still be any tile
+template <typename DomainWords, typename Topology>
+int BasicTileMapGenerator<DomainWords, Topology>::random_domain_tile(const int idx)
+{
+	if (m_possible_tile_counts[idx] == m_tile_count)
+	{
+		return m_tile_set.get_alias_table().sample(m_random);
 	}
 
-	return std::nullopt;
+	return m_tile_weights.sample(get_domain(idx), random_unit(m_random) * m_weight_sums[idx]);
 }
 
-pair<int, int> TileMapGenerator::get_coord(const int idx) const
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::propagate(const int collapsed_idx)
 {
-	return std::make_pair(idx / m_output_width, idx % m_output_width);
+	if (m_propagator == PropagatorType::DomainScan)
+	{
+		m_update_queue.clear();
+		m_update_queue.push_back(collapsed_idx);
+	}
+
+	propagate_queued();
 }
 
-void TileMapGenerator::draw_tile_map() const
+// Propagates the pending removals, the support count propagator's ban stack or the domain scan's update queue
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::propagate_queued()
 {
-	const int mult = 6;  // todo: remove after debugging
-	const int tile_width = 10*mult;
-	const int tile_height = 10*mult;
+	if (m_propagator == PropagatorType::SupportCount)
+	{
+		propagate_support_count();
+		return;
+	}
 
-	int x = 0;
-	int y = 0;
+	recalculate_constraints();
+}
 
-	for (int i = 0; i < m_tile_map.size(); i++)
+// AC-4: withdraw the support of every banned tile from its neighbors, banning neighbor tiles left without support
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::propagate_support_count()
+{
+	while (!m_ban_stack.empty() && !is_contradiction())
 	{
-		const Tile& tile = m_tile_map[i];
-		std::optional<string> tile_name = tile.get_collapsed_name();
+		if (m_stats.is_enabled())
+		{
+			m_stats.on_queue_size(m_ban_stack.size());
+		}
+
+		const auto [idx, tile_id] = m_ban_stack.back();
+		m_ban_stack.pop_back();
 
-		ofSetColor(ofColor::white);
-		if (tile_name.has_value()) {
-			draw_tile(tile_name.value(), x, y, tile_width, tile_height);
+		if (m_is_recording_trail)
+		{
+			m_trail.push_back(TrailEntry{idx, tile_id, TrailEntry::Action::WithdrawSupport});
 		}
-		else {
-			draw_multiple_possibilities(tile, x, y, tile_width, tile_height);
+
+		const int* neighbors = m_topology.get_neighbors(idx);
+		for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+		{
+			const int neighbor_idx = neighbors[side];
+			if (neighbor_idx == Topology::NO_NEIGHBOR)
+			{
+				continue;
+			}
+
+			// the banned tile supported these neighbor tiles from the neighbor's opposite side
+			const int direction_from_neighbor = TileSet::opposite_side(side, Topology::SIDE_COUNT);
+
+			m_adjacency.for_each_allowed(tile_id, side, [&](const int neighbor_tile_id)
+			{
+				int& support = m_support_count[get_support_idx(neighbor_idx, direction_from_neighbor, neighbor_tile_id)];
+				support--;
+
+				if (support == 0 && is_possible(neighbor_idx, neighbor_tile_id))
+				{
+					ban_tile(neighbor_idx, neighbor_tile_id);
+				}
+			});
 		}
+	}
 
-		x += tile_width;
+	// stop propagating on contradiction, the map can't be completed anyway
+	m_ban_stack.clear();
+}
 
-		if (i % m_output_width == m_output_width - 1) {
-			x = 0;
-			y += tile_height;
+// m_update_queue is a FIFO that is only cleared when propagation starts, so after warm-up it doesn't allocate
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::recalculate_constraints()
+{
+	// propagate constraints: update cell's domain & add neighbors if changed
+	for (size_t head = 0; head < m_update_queue.size() && !is_contradiction(); ++head)
+	{
+		if (m_stats.is_enabled())
+		{
+			m_stats.on_queue_size(m_update_queue.size() - head);
 		}
+		update_neighbors_domain(m_update_queue[head]);
 	}
 }
 
-void TileMapGenerator::draw_tile(const string& tile_name, float x, float y, float tile_width, float tile_height) const {
+template <typename DomainWords, typename Topology>
+void BasicTileMapGenerator<DomainWords, Topology>::update_neighbors_domain(const int idx)
+{
+	const int* neighbors = m_topology.get_neighbors(idx);
+	for (int side = 0; side < Topology::SIDE_COUNT; ++side)
+	{
+		if (const int neighbor_idx = neighbors[side]; neighbor_idx != Topology::NO_NEIGHBOR
+		&& update_neighbor_domain(neighbor_idx, get_allowed(get_domain(idx), side)))
+		{
+			m_update_queue.push_back(neighbor_idx);
+		}
+	}
+}
 
-	const int delim_pos = tile_name.find("_");
-	string base_name = tile_name.substr(0, delim_pos);
-	const string rotation_str = tile_name.substr(delim_pos + 1, tile_name.length() - delim_pos - 1);
-	int rotation = rotation_str.empty() ? 0 : atoi(rotation_str.c_str());
+/**
+ * Keeps only the allowed tiles in the neighbor. Returns true iff the neighbor's domain changed, so its own neighbors
+ * have to be updated as well
+ */
+template <typename DomainWords, typename Topology>
+bool BasicTileMapGenerator<DomainWords, Topology>::update_neighbor_domain(const int neighbor_idx, const uint64_t* allowed)
+{
+	const uint64_t* words = get_domain(neighbor_idx);
+	if constexpr (std::is_same_v<DomainWords, DynamicDomainWords>)
+	{
+		// most neighbors keep all their tiles, wide domains are checked with one vectorized pass
+		if (!DomainKernels::is_changed_by(words, allowed, word_count()))
+		{
+			return false;
+		}
+	}
+
+	// banned in tile ID order, ban_tile only clears bits that were already read
+	bool is_changed = false;
+	for (int i = 0; i < word_count(); ++i)
+	{
+		uint64_t removed = words[i] & ~allowed[i];
+		is_changed |= removed != 0;
+		while (removed != 0)
+		{
+			ban_tile(neighbor_idx, i * Domain::BITS_PER_WORD + std::countr_zero(removed));
+			removed &= removed - 1;
+		}
+	}
 
-	const ofImage& image = m_tile_set.images.at(base_name);
-	draw_image(image, x, y, tile_width, tile_height, rotation);
+	return is_changed;
 }
 
 /**
- * superimpose all possibilities with transparency
+ * Returns the tiles a neighbor on that side may keep. A neighbor tile is supported iff a tile still possible in the
+ * domain allows it, so these are the union of the domain's masks towards the neighbor.
+ * The fixed widths OR the masks directly, wider domains let MaskUnion combine each distinct mask once
  */
-void TileMapGenerator::draw_multiple_possibilities(const Tile& tile, float x, float y, float tile_width, float tile_height) const {
-	int number_of_possibilities = tile.domain.size();
-	ofSetColor(ofColor::white, 255 / number_of_possibilities);
+template <typename DomainWords, typename Topology>
+const uint64_t* BasicTileMapGenerator<DomainWords, Topology>::get_allowed(const uint64_t* words, const int side)
+{
+	if constexpr (std::is_same_v<DomainWords, DynamicDomainWords>)
+	{
+		return m_mask_union.compute(words, side);
+	}
 
-	for (const string& possibility_name : tile.domain) {
-		draw_tile(possibility_name, x, y, tile_width, tile_height);
+	std::fill(m_allowed.begin(), m_allowed.end(), 0);
+	for (int i = 0; i < word_count(); ++i)
+	{
+		uint64_t word = words[i];
+		while (word != 0)
+		{
+			const uint64_t* mask = m_adjacency.get_mask(i * Domain::BITS_PER_WORD + std::countr_zero(word), side);
+			for (int j = 0; j < word_count(); ++j)
+			{
+				m_allowed[j] |= mask[j];
+			}
+			word &= word - 1;
+		}
 	}
+
+	return m_allowed.data();
 }
 
-void TileMapGenerator::draw_image(const ofImage& image, float x, float y, float width, float height, int rotation) {
-	ofPushMatrix();
-	// Move the origin to the center of the destination rectangle.
-	ofTranslate(x + width / 2, y + height / 2);
+template <typename DomainWords, typename Topology>
+bool BasicTileMapGenerator<DomainWords, Topology>::drain_dirty_cells(vector<int>& dirty_cells)
+{
+	// swapping hands the list over without copying and keeps both buffers' capacity
+	std::swap(dirty_cells, m_dirty_cells);
+	m_dirty_cells.clear();
 
-	// Apply the rotation (in degrees).
-	ofRotateDeg(rotation);
+	for (const int idx : dirty_cells)
+	{
+		m_is_dirty[idx] = false;
+	}
+
+	const bool is_fully_dirty = m_is_fully_dirty;
+	m_is_fully_dirty = false;
+	if (is_fully_dirty)
+	{
+		dirty_cells.clear();
+	}
 
-	// Draw the image centered at the origin.
-	image.draw(-width / 2, -height / 2, width, height);
-	ofPopMatrix();
+	return is_fully_dirty;
 }
+
+template <typename DomainWords, typename Topology>
+vector<int> BasicTileMapGenerator<DomainWords, Topology>::get_collapsed_ids() const
+{
+	vector<int> tile_ids(get_cell_count(), -1);
+	for (int idx = 0; idx < get_cell_count(); ++idx)
+	{
+		if (!is_collapsed(idx))
+		{
+			continue;
+		}
+
+		const uint64_t* words = get_domain(idx);
+		for (int i = 0; i < word_count(); ++i)
+		{
+			if (words[i] != 0)
+			{
+				tile_ids[idx] = i * Domain::BITS_PER_WORD + std::countr_zero(words[i]);
+				break;
+			}
+		}
+	}
+
+	return tile_ids;
+}
+
+// The instantiations TileMapSolver dispatches between, TileMapGenerator is BasicTileMapGenerator<DynamicDomainWords, SquareGrid>
+template class BasicTileMapGenerator<FixedDomainWords<1>, SquareGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<2>, SquareGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<4>, SquareGrid>;
+template class BasicTileMapGenerator<DynamicDomainWords, SquareGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<1>, ToroidalGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<2>, ToroidalGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<4>, ToroidalGrid>;
+template class BasicTileMapGenerator<DynamicDomainWords, ToroidalGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<1>, HexGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<2>, HexGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<4>, HexGrid>;
+template class BasicTileMapGenerator<DynamicDomainWords, HexGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<1>, VoxelGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<2>, VoxelGrid>;
+template class BasicTileMapGenerator<FixedDomainWords<4>, VoxelGrid>;
+template class BasicTileMapGenerator<DynamicDomainWords, VoxelGrid>;
@@ -1,64 +1,385 @@
 #pragma once
 
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_set>
 #include <deque>
+#include <queue>
+#include <functional>
+#include <optional>
+#include <random>
+#include <utility>
 
+#include "Data/MaskUnion.h"
 #include "Data/TileSet.h"
 #include "Data/Tile.h"
+#include "Data/TileWeights.h"
+#include "Generation/DomainWords.h"
+#include "Generation/GridTopology.h"
+#include "Generation/GenerationStats.h"
+#include "Util/Random.h"
 
-class TileMapGenerator
+/**
+ * @class TileMapGeneratorBase
+ * @brief The result and settings types of BasicTileMapGenerator, shared by all its instantiations
+ */
+class TileMapGeneratorBase
 {
 public:
-	bool is_tile_map_finished = false;
+	/**
+	 * @brief Constraint propagation strategies.
+	 * DomainScan rescans every candidate of a changed cell's neighbors against the cell's domain.
+	 * SupportCount (AC-4) keeps per cell, side and tile the number of supporting neighbor tiles, so each removal costs O(tiles).
+	 */
+	enum class PropagatorType { DomainScan, SupportCount };
 
-	explicit TileMapGenerator(const TileSet& tile_set);
+	enum class GenerationStatus { InProgress, Finished, Contradiction };
 
-	void generate_tile_map(int width, int height);
-	void init_tile_map(int width, int height);
-	void generate_single_step();
+	struct GenerationResult {
+		GenerationStatus status = GenerationStatus::InProgress;
+		// the cell whose domain became empty, only set on contradiction
+		std::optional<int> contradiction_idx;
+	};
+
+	// Returned by the batched stepping APIs
+	struct GenerationProgress {
+		GenerationResult result;
+		// steps run by this call
+		int steps = 0;
+		int remaining_cells = 0;
+	};
+
+	/**
+	 * @brief Limits of the optional backtracking mode. On contradiction the solver undoes the last decision
+	 * and bans the tile that failed, unwinding further decisions while that contradicts as well.
+	 * When a limit is hit the map is restarted, after max_restarts restarts the contradiction is reported
+	 */
+	struct BacktrackingSettings {
+		bool is_enabled = false;
+		// decisions a single contradiction may undo
+		int max_depth = 64;
+		// decisions undone in total before restarting
+		int max_backtracks = 1000;
+		int max_restarts = 10;
+	};
+};
+
+/**
+ * @class BasicTileMapGenerator
+ * @brief Wave function collapse solver over a TileSet, compiled for one domain width and one grid topology. Has no
+ * openFrameworks dependency, drawing is done by TileMapRenderer. Cells are flat arrays of domain words and running
+ * weight sums, with FixedDomainWords<1> a small tile set's domain operations are single instructions.
+ * Wider than the fixed widths, masks are combined with the DomainKernels, each distinct mask once.
+ * TileMapSolver dispatches between the instantiations at runtime
+ * @tparam DomainWords FixedDomainWords<N> with N words per domain, or DynamicDomainWords
+ * @tparam Topology Neighbor table of the grid, see GridTopology.h. Its SIDE_COUNT has to match the tile set's number of sides
+ */
+template <typename DomainWords, typename Topology>
+class BasicTileMapGenerator : public TileMapGeneratorBase
+{
+public:
+	explicit BasicTileMapGenerator(const TileSet& tile_set, PropagatorType propagator = PropagatorType::DomainScan);
+
+	PropagatorType get_propagator() const { return m_propagator; }
+
+	/**
+	 * @brief Seeds the generator's own random engine, the next init_tile_map with the same seed generates the same map.
+	 * The random sequence is the same on every platform, the entropies use std::log, so maps are only guaranteed to
+	 * match between builds with the same math library. Unless seeded, the engine is seeded from std::random_device
+	 */
+	void set_seed(uint64_t seed);
+
+	/**
+	 * @brief Applies from the next init_tile_map on
+	 */
+	void set_backtracking(const BacktrackingSettings& settings) { m_backtracking = settings; }
+	const BacktrackingSettings& get_backtracking() const { return m_backtracking; }
+
+	/**
+	 * @param depth Number of layers of a voxel grid, the 2D grids ignore it
+	 */
+	GenerationResult generate_tile_map(int width, int height, int depth = 1);
+
+	/**
+	 * @brief Resets every cell, pinned cells to their tile. Pins are kept unless the map size changes
+	 */
+	void init_tile_map(int width, int height, int depth = 1);
+	GenerationResult generate_single_step();
+
+	/**
+	 * @brief Fixes the cell of the current map to tile_id. Takes effect when the cell is reset, by init_tile_map or
+	 * a reset_region that covers it, and holds through restarts and backtracking
+	 */
+	void pin_cell(int idx, int tile_id);
+	void unpin_cell(int idx);
+	void clear_pins();
+	// the tile the cell is pinned to, if any
+	std::optional<int> get_pinned_tile(const int idx) const { return m_pinned_tiles[idx] >= 0 ? std::optional<int>(m_pinned_tiles[idx]) : std::nullopt; }
+
+	/**
+	 * @brief Resets the region's cells to full superposition, or to their pinned tile, and re-derives their constraints
+	 * from the cells bordering the region. Cells outside the region keep their domains, and the following steps only
+	 * collapse the region's cells until it's solved. On an unfinished map the remaining cells outside are collapsed
+	 * after that. The work done is proportional to the region's size, not the map's.
+	 * A restart after a contradiction the backtracking couldn't repair resets the region again, not the map
+	 * @param region_cells Indices of the region's cells, e.g. an editor's selection mask, without duplicates
+	 * @return Contradiction if the region can't be solved given its border and pins, InProgress otherwise
+	 */
+	GenerationResult reset_region(const vector<int>& region_cells);
+
+	/**
+	 * @brief Resets the cells of the rectangle on the first layer, clipped to the map
+	 */
+	GenerationResult reset_region(int x, int y, int width, int height);
+
+	/**
+	 * @brief Resets the rectangle and generates it until it's finished or contradicts
+	 */
+	GenerationResult regenerate_region(int x, int y, int width, int height);
+
+	/**
+	 * @brief Runs up to step_count steps, stops early when the map is finished or contradicts
+	 */
+	GenerationProgress generate_steps(int step_count);
+
+	/**
+	 * @brief Runs steps until the budget is used up, the map is finished or it contradicts.
+	 * Runs at least one step, a step that starts within the budget may finish after it
+	 */
+	GenerationProgress generate_for(std::chrono::microseconds budget);
+
+	const GenerationResult& get_result() const { return m_result; }
+	bool is_tile_map_finished() const { return m_result.status != GenerationStatus::InProgress; }
+	int get_remaining_cells() const { return m_remaining_cells; }
+
+	// backtracking counters since init_tile_map
+	int get_backtrack_count() const { return m_backtrack_count; }
+	int get_restart_count() const { return m_restart_count; }
+
+	/**
+	 * @brief Enables per-step instrumentation of generate_single_step, disabled by default. Stats are reset by init_tile_map
+	 */
+	void set_stats_mode(const GenerationStats::Mode mode) { m_stats.set_mode(mode); }
+	const GenerationStats& get_stats() const { return m_stats; }
+
+	int get_width() const { return m_output_width; }
+	int get_height() const { return m_output_height; }
+	int get_depth() const { return m_output_depth; }
+	int get_cell_count() const { return static_cast<int>(m_possible_tile_counts.size()); }
+
+	/**
+	 * @brief Returns a copy of the cell's domain and weight sums, e.g. for a renderer's snapshot
+	 */
+	Tile get_tile(int idx) const;
 
-	void draw_tile_map() const;
+	/**
+	 * @brief Moves the cells whose domain changed since the last call into dirty_cells, for renderers that only redraw changes
+	 * @return true if the whole map has to be redrawn since it was (re)initialized, dirty_cells is then empty
+	 */
+	bool drain_dirty_cells(vector<int>& dirty_cells);
+
+	/**
+	 * @brief Returns the collapsed tile ID of every cell layer by layer in row-major order, -1 for cells that didn't collapse
+	 */
+	vector<int> get_collapsed_ids() const;
 
 private:
-	using TileMap = vector<Tile>;
-	using SupportCount = vector<unordered_map<string, int>>;
+	using SupportCount = vector<int>;
+
+	struct EntropyEntry {
+		double entropy;
+		int idx;
+
+		bool operator>(const EntropyEntry& other) const { return entropy > other.entropy; }
+	};
+
+	// Min-heap of cells by entropy. Entries are invalidated lazily: an entry is stale if the cell
+	// collapsed or its entropy changed since it was pushed
+	using EntropyHeap = std::priority_queue<EntropyEntry, vector<EntropyEntry>, std::greater<>>;
+
+	using Clock = std::chrono::steady_clock;
+
+	// returned by get_next_cell_to_collapse when no cell can be collapsed
+	static constexpr int NO_CELL = -1;
+
+	// any engine with 64 bit output and seed(uint64_t) can be plugged in here
+	using RandomEngine = Xoshiro256;
+
+	// A tile that was removed from a cell's domain and whose support wasn't withdrawn from the neighbors yet
+	struct BanEntry {
+		int idx;
+		int tile_id;
+	};
+
+	// A removal on the backtracking trail. Undone in reverse order, which restores the exact state before the removal
+	struct TrailEntry {
+		enum class Action : uint8_t { Ban, WithdrawSupport };
 
-	struct QueueEntry {
-		std::reference_wrapper<Tile> tile;
 		int idx;
+		int tile_id;
+		Action action;
 	};
 
-	int m_output_width, m_output_height;
+	// A collapse that can be undone, the trail entries from trail_size on were made by it and its propagation
+	struct Decision {
+		int idx;
+		int tile_id;
+		size_t trail_size;
+	};
+
+	int m_output_width = 0, m_output_height = 0, m_output_depth = 0;
 	const TileSet& m_tile_set;
-	unordered_set<string> m_all_tile_names;
+	const AdjacencyTable& m_adjacency;
+	const PropagatorType m_propagator;
+	const DomainWords m_words;
+	const int m_tile_count;
+	// owned per generator, so generators on different threads don't share random state
+	RandomEngine m_random;
+
+	// domain and weight sums of a cell that can still be any of the set's tiles
+	vector<uint64_t> m_full_domain;
+	double m_full_weight_sum = 0;
+	double m_full_weight_log_weight_sum = 0;
+	TileWeights m_tile_weights;
+	// per side, the tiles some tile allows next to them on that side. Only used if a tile has no neighbor on a side
+	vector<uint64_t> m_supported_tiles;
+	bool m_has_unsupported_tiles = false;
+
+	// per cell, word_count() words each. Bit i is set iff tile ID i (see TileSet::get_name) is still possible
+	vector<uint64_t> m_domains;
+	// per cell number of possible tiles and running sums of w and w*log(w) over them, kept up to date by ban_tile
+	vector<int> m_possible_tile_counts;
+	vector<double> m_weight_sums;
+	vector<double> m_weight_log_weight_sums;
+	// neighbor of every cell on every side, rebuilt when the map size changes
+	Topology m_topology;
+
+	// live number of cells with more than one possible tile, updated by ban_tile
+	int m_remaining_cells = 0;
+	GenerationResult m_result;
 
-	TileMap m_tile_map;
+	GenerationStats m_stats;
 
-	// m_support_count[idx + side][tile_name] = how many neighbor tiles on this side support/allow tile_name
+	EntropyHeap m_entropy_heap;
+	// small random noise per cell, breaks ties between cells with the same entropy
+	vector<double> m_entropy_noise;
+	// entropy plus noise of the cell's newest heap entry, only valid while it has more than one possible tile
+	vector<double> m_entropy;
+	// cells whose domain changed since the last time they were pushed to m_entropy_heap
+	vector<int> m_touched_cells;
+	vector<bool> m_is_touched;
+	// cells whose domain changed since the last drain_dirty_cells
+	vector<int> m_dirty_cells;
+	vector<bool> m_is_dirty;
+	bool m_is_fully_dirty = true;
+
+	// m_support_count[get_support_idx(idx, side, tile_id)] = how many neighbor tiles on this side support/allow tile_id
 	SupportCount m_support_count;
+	vector<BanEntry> m_ban_stack;
+	// cells whose neighbors have to be updated by the domain scan propagator
+	vector<int> m_update_queue;
+	// tiles the domain scan propagator lets a neighbor keep, m_allowed for the fixed widths
+	MaskUnion m_mask_union;
+	vector<uint64_t> m_allowed;
+
+	BacktrackingSettings m_backtracking;
+	// every removal since init_tile_map, only recorded when backtracking is enabled
+	vector<TrailEntry> m_trail;
+	vector<Decision> m_decisions;
+	// m_backtracking.is_enabled at the last reset, changing the settings mid-generation doesn't affect the trail
+	bool m_is_recording_trail = false;
+	int m_backtrack_count = 0;
+	int m_attempt_backtrack_count = 0;
+	int m_restart_count = 0;
+
+	// pinned tile ID per cell or -1, and the pinned cells
+	vector<int> m_pinned_tiles;
+	vector<int> m_pinned_cells;
+	// cells of the last reset_region, empty when the whole map was reset last
+	vector<int> m_region_cells;
+	// flags of m_region_cells while only they are selected, see reset_region
+	vector<bool> m_is_in_region;
+	bool m_is_selecting_region = false;
 
-	std::optional<int> get_idx(const int row, const int col) const;
-	std::optional<int> get_neighbor_idx(const int idx, const int side) const;
-	pair<int, int> get_coord(const int idx) const;
+	int word_count() const { return m_words.word_count(); }
+	uint64_t* get_domain(const int idx) { return m_domains.data() + static_cast<size_t>(idx) * word_count(); }
+	const uint64_t* get_domain(const int idx) const { return m_domains.data() + static_cast<size_t>(idx) * word_count(); }
+	bool is_possible(const int idx, const int tile_id) const { return (get_domain(idx)[tile_id / Domain::BITS_PER_WORD] >> (tile_id % Domain::BITS_PER_WORD)) & 1; }
+	bool is_collapsed(const int idx) const { return m_possible_tile_counts[idx] == 1; }
 
+	/**
+	 * @brief Calls func(tile_id) for every possible tile ID of the cell in ascending order.
+	 * Each word is read before its bits are visited, so func may ban the visited tile ID
+	 */
+	template <typename Func>
+	void for_each_possible_tile(const int idx, Func&& func) const
+	{
+		const uint64_t* words = get_domain(idx);
+		for (int i = 0; i < word_count(); ++i)
+		{
+			uint64_t word = words[i];
+			while (word != 0)
+			{
+				func(i * Domain::BITS_PER_WORD + std::countr_zero(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+	void reset_cell(int idx);
+	void reset_tile_map();
+	void reset_region_cells();
+	void end_region_selection(bool is_rebuilding_heap = true);
+	void restart();
+	void apply_pins(const vector<int>& cells);
+	void init_region_support_count();
+
+	int get_support_idx(const int idx, const int side, const int tile_id) const { return (idx * Topology::SIDE_COUNT + side) * m_tile_count + tile_id; }
 	void init_support_count();
+	void prune_unsupported_tiles(int idx);
 
-	int get_next_cell_to_collapse(TileMap& cells) const;
-	float compute_cell_entropy(const Tile& cell) const;
+	void init_entropy_heap();
+	void build_entropy_heap();
+	void push_touched_cells();
+	// H = -sum(p*log(p)) with p = w/W, which simplifies to log(W) - sum(w*log(w))/W
+	double get_cell_entropy(const int idx) const
+	{
+		return std::log(m_weight_sums[idx]) - m_weight_log_weight_sums[idx] / m_weight_sums[idx] + m_entropy_noise[idx];
+	}
+	/**
+	 * @brief Pops the lowest entropy cell off the heap, skipping stale entries
+	 * @return NO_CELL after reporting a contradiction if the heap has no valid entry left
+	 */
+	int get_next_cell_to_collapse();
 
+	int random_domain_tile(int idx);
+	int collapse_cell(int idx);
+	void ban_tile(int idx, int tile_id);
+	void touch_cell(int idx);
 
-	string random_domain_tile(const Tile& tile) const;
-	void collapse_cell(int idx);
+	void backtrack();
+	void undo_trail(size_t trail_size);
+	void restore_support(int idx, int tile_id);
+	void add_possible_tile(int idx, int tile_id);
 
-	void recalculate_constraints(TileMap& cells, std::deque<QueueEntry>& tiles_to_update_queue);
-	deque<QueueEntry> update_neighbors_domain(int idx, TileMap& cells);
-	bool update_neighbor_domain(const Tile& current_tile, Tile& neighbor, const int direction_from_neighbor);
+	void propagate(int collapsed_idx);
+	void propagate_queued();
+	void propagate_support_count();
+	void recalculate_constraints();
+	void update_neighbors_domain(int idx);
+	bool update_neighbor_domain(int neighbor_idx, const uint64_t* allowed);
+	const uint64_t* get_allowed(const uint64_t* words, int side);
 
-	int count_remaining_cells(const TileMap& cells);
+	Clock::time_point start_phase() { return m_stats.is_enabled() ? m_stats.begin_step() : Clock::time_point{}; }
+	void end_phase(double& phase_seconds, Clock::time_point& phase_start) const;
 
-	void draw_tile(const string& tile_name, float x, float y, float tile_width, float tile_height) const;
-	void draw_multiple_possibilities(const Tile& tile, float x, float y, float tile_width, float tile_height) const;
-	static void draw_image(const ofImage& image, float x, float y, float width, float height, int rotation);
+	bool is_contradiction() const { return m_result.status == GenerationStatus::Contradiction; }
+	void update_finished_status();
 };
+
+// The square grid generator of the app and the tools, any tile set width
+using TileMapGenerator = BasicTileMapGenerator<DynamicDomainWords, SquareGrid>;
@@ -0,0 +1,404 @@
+#include "DomainKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__)
+#define WFC_HAS_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define WFC_HAS_X86_KERNELS 0
+#endif
+
+namespace
+{
+	struct KernelTable
+	{
+		void (*union_into)(uint64_t* dst, const uint64_t* src, int word_count);
+		bool (*intersect)(uint64_t* dst, const uint64_t* mask, int word_count);
+		bool (*is_changed_by)(const uint64_t* domain, const uint64_t* mask, int word_count);
+		int (*popcount)(const uint64_t* words, int word_count);
+		DomainKernels::WeightSums (*weighted_popcount)(const uint64_t* words, int word_count, const double* weights, const double* weight_log_weights);
+	};
+
+	// Scalar kernels, also the tails of the vector ones
+
+	void union_into_scalar(uint64_t* dst, const uint64_t* src, const int word_count)
+	{
+		for (int i = 0; i < word_count; ++i)
+		{
+			dst[i] |= src[i];
+		}
+	}
+
+	bool intersect_scalar(uint64_t* dst, const uint64_t* mask, const int word_count)
+	{
+		uint64_t removed = 0;
+		for (int i = 0; i < word_count; ++i)
+		{
+			removed |= dst[i] & ~mask[i];
+			dst[i] &= mask[i];
+		}
+		return removed != 0;
+	}
+
+	bool is_changed_by_scalar(const uint64_t* domain, const uint64_t* mask, const int word_count)
+	{
+		for (int i = 0; i < word_count; ++i)
+		{
+			if ((domain[i] & ~mask[i]) != 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int popcount_scalar(const uint64_t* words, const int word_count)
+	{
+		int count = 0;
+		for (int i = 0; i < word_count; ++i)
+		{
+			count += std::popcount(words[i]);
+		}
+		return count;
+	}
+
+	DomainKernels::WeightSums weighted_popcount_scalar(const uint64_t* words, const int word_count, const double* weights, const double* weight_log_weights)
+	{
+		DomainKernels::WeightSums sums;
+		for (int i = 0; i < word_count; ++i)
+		{
+			uint64_t word = words[i];
+			while (word != 0)
+			{
+				const int tile_id = i * 64 + std::countr_zero(word);
+				sums.weight_sum += weights[tile_id];
+				sums.weight_log_weight_sum += weight_log_weights[tile_id];
+				word &= word - 1;
+			}
+		}
+		return sums;
+	}
+
+	constexpr KernelTable SCALAR_KERNELS{union_into_scalar, intersect_scalar, is_changed_by_scalar, popcount_scalar, weighted_popcount_scalar};
+
+#if WFC_HAS_X86_KERNELS
+
+	// SSE4.2 kernels, 2 words per instruction and the popcnt instruction
+
+	__attribute__((target("sse4.2,popcnt")))
+	void union_into_sse42(uint64_t* dst, const uint64_t* src, const int word_count)
+	{
+		int i = 0;
+		for (; i + 2 <= word_count; i += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(a, b));
+		}
+		union_into_scalar(dst + i, src + i, word_count - i);
+	}
+
+	__attribute__((target("sse4.2,popcnt")))
+	bool intersect_sse42(uint64_t* dst, const uint64_t* mask, const int word_count)
+	{
+		__m128i removed = _mm_setzero_si128();
+		int i = 0;
+		for (; i + 2 <= word_count; i += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+			removed = _mm_or_si128(removed, _mm_andnot_si128(m, a));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(a, m));
+		}
+		const bool is_tail_changed = intersect_scalar(dst + i, mask + i, word_count - i);
+		return !_mm_testz_si128(removed, removed) || is_tail_changed;
+	}
+
+	__attribute__((target("sse4.2,popcnt")))
+	bool is_changed_by_sse42(const uint64_t* domain, const uint64_t* mask, const int word_count)
+	{
+		int i = 0;
+		for (; i + 2 <= word_count; i += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(domain + i));
+			const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+			// testc is 1 iff every bit of a is set in m
+			if (!_mm_testc_si128(m, a))
+			{
+				return true;
+			}
+		}
+		return is_changed_by_scalar(domain + i, mask + i, word_count - i);
+	}
+
+	__attribute__((target("sse4.2,popcnt")))
+	int popcount_sse42(const uint64_t* words, const int word_count)
+	{
+		int64_t count = 0;
+		for (int i = 0; i < word_count; ++i)
+		{
+			count += _mm_popcnt_u64(words[i]);
+		}
+		return static_cast<int>(count);
+	}
+
+	// 2 tiles at a time, skipping the pairs without a set bit
+	__attribute__((target("sse4.2,popcnt")))
+	DomainKernels::WeightSums weighted_popcount_sse42(const uint64_t* words, const int word_count, const double* weights, const double* weight_log_weights)
+	{
+		const __m128i lane_bits = _mm_set_epi64x(2, 1);
+		__m128d weight_sum = _mm_setzero_pd();
+		__m128d weight_log_weight_sum = _mm_setzero_pd();
+
+		for (int i = 0; i < word_count; ++i)
+		{
+			uint64_t word = words[i];
+			while (word != 0)
+			{
+				const int first_bit = std::countr_zero(word) & ~1;
+				const __m128i pair = _mm_set1_epi64x(static_cast<int64_t>(word >> first_bit & 3));
+				const __m128d lane_mask = _mm_castsi128_pd(_mm_cmpeq_epi64(_mm_and_si128(pair, lane_bits), lane_bits));
+
+				const int tile_id = i * 64 + first_bit;
+				weight_sum = _mm_add_pd(weight_sum, _mm_and_pd(_mm_loadu_pd(weights + tile_id), lane_mask));
+				weight_log_weight_sum = _mm_add_pd(weight_log_weight_sum, _mm_and_pd(_mm_loadu_pd(weight_log_weights + tile_id), lane_mask));
+				word &= ~(uint64_t{3} << first_bit);
+			}
+		}
+
+		double lanes[2];
+		DomainKernels::WeightSums sums;
+		_mm_storeu_pd(lanes, weight_sum);
+		sums.weight_sum = lanes[0] + lanes[1];
+		_mm_storeu_pd(lanes, weight_log_weight_sum);
+		sums.weight_log_weight_sum = lanes[0] + lanes[1];
+		return sums;
+	}
+
+	constexpr KernelTable SSE42_KERNELS{union_into_sse42, intersect_sse42, is_changed_by_sse42, popcount_sse42, weighted_popcount_sse42};
+
+	// AVX2 kernels, 4 words per instruction
+
+	__attribute__((target("avx2,popcnt")))
+	void union_into_avx2(uint64_t* dst, const uint64_t* src, const int word_count)
+	{
+		int i = 0;
+		for (; i + 4 <= word_count; i += 4)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(a, b));
+		}
+		union_into_scalar(dst + i, src + i, word_count - i);
+	}
+
+	__attribute__((target("avx2,popcnt")))
+	bool intersect_avx2(uint64_t* dst, const uint64_t* mask, const int word_count)
+	{
+		__m256i removed = _mm256_setzero_si256();
+		int i = 0;
+		for (; i + 4 <= word_count; i += 4)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + i));
+			removed = _mm256_or_si256(removed, _mm256_andnot_si256(m, a));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(a, m));
+		}
+		const bool is_tail_changed = intersect_scalar(dst + i, mask + i, word_count - i);
+		return !_mm256_testz_si256(removed, removed) || is_tail_changed;
+	}
+
+	__attribute__((target("avx2,popcnt")))
+	bool is_changed_by_avx2(const uint64_t* domain, const uint64_t* mask, const int word_count)
+	{
+		int i = 0;
+		for (; i + 4 <= word_count; i += 4)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(domain + i));
+			const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + i));
+			if (!_mm256_testc_si256(m, a))
+			{
+				return true;
+			}
+		}
+		return is_changed_by_scalar(domain + i, mask + i, word_count - i);
+	}
+
+	// Nibble lookup popcount (Mula), bytes are summed into 64 bit lanes by sad_epu8
+	__attribute__((target("avx2,popcnt")))
+	int popcount_avx2(const uint64_t* words, const int word_count)
+	{
+		const __m256i nibble_counts = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+
+		__m256i counts = _mm256_setzero_si256();
+		int i = 0;
+		for (; i + 4 <= word_count; i += 4)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			const __m256i low = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(v, low_nibbles));
+			const __m256i high = _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles));
+			counts = _mm256_add_epi64(counts, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+		}
+
+		int64_t lanes[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), counts);
+		int64_t count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		for (; i < word_count; ++i)
+		{
+			count += _mm_popcnt_u64(words[i]);
+		}
+		return static_cast<int>(count);
+	}
+
+	// 4 tiles at a time, skipping the nibbles without a set bit
+	__attribute__((target("avx2,popcnt")))
+	DomainKernels::WeightSums weighted_popcount_avx2(const uint64_t* words, const int word_count, const double* weights, const double* weight_log_weights)
+	{
+		const __m256i lane_bits = _mm256_setr_epi64x(1, 2, 4, 8);
+		__m256d weight_sum = _mm256_setzero_pd();
+		__m256d weight_log_weight_sum = _mm256_setzero_pd();
+
+		for (int i = 0; i < word_count; ++i)
+		{
+			uint64_t word = words[i];
+			while (word != 0)
+			{
+				const int first_bit = std::countr_zero(word) & ~3;
+				const __m256i nibble = _mm256_set1_epi64x(static_cast<int64_t>(word >> first_bit & 0xF));
+				const __m256d lane_mask = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(nibble, lane_bits), lane_bits));
+
+				const int tile_id = i * 64 + first_bit;
+				weight_sum = _mm256_add_pd(weight_sum, _mm256_and_pd(_mm256_loadu_pd(weights + tile_id), lane_mask));
+				weight_log_weight_sum = _mm256_add_pd(weight_log_weight_sum, _mm256_and_pd(_mm256_loadu_pd(weight_log_weights + tile_id), lane_mask));
+				word &= ~(uint64_t{0xF} << first_bit);
+			}
+		}
+
+		double lanes[4];
+		DomainKernels::WeightSums sums;
+		_mm256_storeu_pd(lanes, weight_sum);
+		sums.weight_sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm256_storeu_pd(lanes, weight_log_weight_sum);
+		sums.weight_log_weight_sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		return sums;
+	}
+
+	constexpr KernelTable AVX2_KERNELS{union_into_avx2, intersect_avx2, is_changed_by_avx2, popcount_avx2, weighted_popcount_avx2};
+
+#endif
+
+	const KernelTable& get_kernels(const DomainKernels::Isa isa)
+	{
+#if WFC_HAS_X86_KERNELS
+		switch (isa)
+		{
+		case DomainKernels::Isa::Avx2:
+			return AVX2_KERNELS;
+		case DomainKernels::Isa::Sse42:
+			return SSE42_KERNELS;
+		default:
+			break;
+		}
+#endif
+		return SCALAR_KERNELS;
+	}
+
+	struct ActiveKernels
+	{
+		std::atomic<DomainKernels::Isa> isa;
+		std::atomic<const KernelTable*> kernels;
+	};
+
+	// resolved on first use, so kernels called during static initialization are dispatched too
+	ActiveKernels& get_active()
+	{
+		static ActiveKernels active{DomainKernels::get_supported_isa(), &get_kernels(DomainKernels::get_supported_isa())};
+		return active;
+	}
+
+	const KernelTable& kernels()
+	{
+		return *get_active().kernels.load(std::memory_order_relaxed);
+	}
+}
+
+DomainKernels::Isa DomainKernels::get_supported_isa()
+{
+#if WFC_HAS_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+	{
+		return Isa::Avx2;
+	}
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+	{
+		return Isa::Sse42;
+	}
+#endif
+	return Isa::Scalar;
+}
+
+DomainKernels::Isa DomainKernels::get_isa()
+{
+	return get_active().isa.load(std::memory_order_relaxed);
+}
+
+void DomainKernels::set_isa(const Isa isa)
+{
+	const Isa supported_isa = static_cast<Isa>(std::min(static_cast<int>(isa), static_cast<int>(get_supported_isa())));
+
+	ActiveKernels& active = get_active();
+	active.isa.store(supported_isa, std::memory_order_relaxed);
+	active.kernels.store(&get_kernels(supported_isa), std::memory_order_relaxed);
+}
+
+const char* DomainKernels::get_isa_name(const Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::Avx2:
+		return "avx2";
+	case Isa::Sse42:
+		return "sse4.2";
+	default:
+		return "scalar";
+	}
+}
+
+void DomainKernels::union_into(uint64_t* dst, const uint64_t* src, const int word_count)
+{
+	kernels().union_into(dst, src, word_count);
+}
+
+bool DomainKernels::intersect(uint64_t* dst, const uint64_t* mask, const int word_count)
+{
+	return kernels().intersect(dst, mask, word_count);
+}
+
+bool DomainKernels::is_changed_by(const uint64_t* domain, const uint64_t* mask, const int word_count)
+{
+	return kernels().is_changed_by(domain, mask, word_count);
+}
+
+int DomainKernels::popcount(const uint64_t* words, const int word_count)
+{
+	return kernels().popcount(words, word_count);
+}
+
+DomainKernels::WeightSums DomainKernels::weighted_popcount(const uint64_t* words, const int word_count, const double* weights, const double* weight_log_weights)
+{
+	return kernels().weighted_popcount(words, word_count, weights, weight_log_weights);
+}
+
+// H = log(W) - sum(w*log(w))/W, see Tile::get_entropy
+double DomainKernels::entropy(const uint64_t* words, const int word_count, const double* weights, const double* weight_log_weights)
+{
+	const WeightSums sums = weighted_popcount(words, word_count, weights, weight_log_weights);
+	return sums.weight_sum > 0 ? std::log(sums.weight_sum) - sums.weight_log_weight_sum / sums.weight_sum : 0;
+}
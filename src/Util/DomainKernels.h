@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @class DomainKernels
+ * @brief Word-parallel operations on domain bitsets and adjacency masks, with AVX2, SSE4.2 and scalar versions.
+ * The best version the CPU supports is picked at runtime, so the binary doesn't need to be built for a specific CPU.
+ * Each call goes through a function pointer, worth it for domains of a few words and more, i.e. tile sets with
+ * hundreds to thousands of tiles. Small fixed-width domains are better served by inlined loops, see DomainWords.h
+ */
+class DomainKernels
+{
+public:
+	enum class Isa { Scalar, Sse42, Avx2 };
+
+	struct WeightSums
+	{
+		double weight_sum = 0;
+		double weight_log_weight_sum = 0;
+	};
+
+	/**
+	 * @brief Returns the best instruction set the CPU supports
+	 */
+	static Isa get_supported_isa();
+
+	static Isa get_isa();
+
+	/**
+	 * @brief Selects the kernels of the instruction set, or of the best supported one below it. For benchmarks,
+	 * the kernels of every instruction set compute the same results
+	 */
+	static void set_isa(Isa isa);
+
+	static const char* get_isa_name(Isa isa);
+
+	// dst |= src
+	static void union_into(uint64_t* dst, const uint64_t* src, int word_count);
+
+	/**
+	 * @brief dst &= mask
+	 * @return true iff any bit of dst was cleared
+	 */
+	static bool intersect(uint64_t* dst, const uint64_t* mask, int word_count);
+
+	/**
+	 * @brief Returns true iff intersecting the domain with the mask would clear a bit, i.e. domain & ~mask isn't empty
+	 */
+	static bool is_changed_by(const uint64_t* domain, const uint64_t* mask, int word_count);
+
+	static int popcount(const uint64_t* words, int word_count);
+
+	/**
+	 * @brief Sums the weights and w*log(w) of the set bits' tile IDs. Summed in another order than tile by tile,
+	 * so the last bits may differ from running sums
+	 * @param weights, weight_log_weights Padded to word_count * 64 entries
+	 */
+	static WeightSums weighted_popcount(const uint64_t* words, int word_count, const double* weights, const double* weight_log_weights);
+
+	/**
+	 * @brief Shannon entropy of the set bits' tiles from their weighted popcount, 0 for an empty domain
+	 */
+	static double entropy(const uint64_t* words, int word_count, const double* weights, const double* weight_log_weights);
+};
@@ -0,0 +1,59 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const string& path)
+{
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	struct stat file_stat{};
+	if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+		{
+			m_data = static_cast<const uint8_t*>(mapping);
+			m_size = static_cast<size_t>(file_stat.st_size);
+		}
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+MappedFile::MappedFile(const string& path, const size_t size)
+{
+	const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	if (size > 0 && ftruncate(fd, static_cast<off_t>(size)) == 0)
+	{
+		void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapping != MAP_FAILED)
+		{
+			m_data = static_cast<const uint8_t*>(mapping);
+			m_size = size;
+			m_is_writable = true;
+		}
+	}
+
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+/**
+ * @class MappedFile
+ * @brief Memory mapping of a whole file, unmapped on destruction. Read-only, or writable and shared with the file
+ */
+class MappedFile
+{
+public:
+	/**
+	 * @brief Maps the file, is_open() is false if it doesn't exist or can't be mapped
+	 */
+	explicit MappedFile(const string& path);
+
+	/**
+	 * @brief Creates or truncates the file to size zeroed bytes and maps it writable, changes are written back to the file.
+	 * The file is sparse where supported, so untouched pages take neither memory nor disk space
+	 */
+	MappedFile(const string& path, size_t size);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return m_data != nullptr; }
+	const uint8_t* data() const { return m_data; }
+	// nullptr unless the file was mapped writable
+	uint8_t* writable_data() { return m_is_writable ? const_cast<uint8_t*>(m_data) : nullptr; }
+	size_t size() const { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_is_writable = false;
+};
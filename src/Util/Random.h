@@ -0,0 +1,74 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @class Xoshiro256
+ * @brief xoshiro256** random engine. Small, fast and, unlike std::rand and the std distributions,
+ * produces the same sequence for a seed on every platform and standard library.
+ * Satisfies UniformRandomBitGenerator, so it can be swapped for another engine with 64 bit output
+ */
+class Xoshiro256
+{
+public:
+	using result_type = uint64_t;
+
+	explicit Xoshiro256(const uint64_t seed_value = 0) { seed(seed_value); }
+
+	/**
+	 * @brief Expands the seed into the 256 bit state with splitmix64, which never yields the all-zero state
+	 */
+	void seed(uint64_t seed_value)
+	{
+		for (uint64_t& word : m_state)
+		{
+			seed_value += 0x9E3779B97F4A7C15;
+			uint64_t z = seed_value;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()()
+	{
+		const uint64_t result = std::rotl(m_state[1] * 5, 7) * 9;
+		const uint64_t t = m_state[1] << 17;
+
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = std::rotl(m_state[3], 45);
+
+		return result;
+	}
+
+private:
+	uint64_t m_state[4];
+};
+
+/**
+ * @brief Returns a uniform double in [0, 1) built from the engine's top 53 bits
+ */
+template <typename Engine>
+double random_unit(Engine& engine)
+{
+	return static_cast<double>(engine() >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Returns a uniform integer in [0, bound), bound > 0
+ */
+template <typename Engine>
+int random_below(Engine& engine, const int bound)
+{
+	// the multiply-shift maps 32 random bits to [0, bound) without a division
+	return static_cast<int>(((engine() >> 32) * static_cast<uint64_t>(bound)) >> 32);
+}
@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(const int thread_count)
+{
+	const int worker_count = std::max(1, thread_count);
+
+	for (int i = 0; i < worker_count; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (int i = 0; i < worker_count; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait_idle();
+
+	{
+		std::lock_guard lock(m_wake_mutex);
+		m_is_stopping = true;
+	}
+	m_wake_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(Task task)
+{
+	const int worker_index = get_current_worker_index();
+	const int queue_index = worker_index >= 0 ? worker_index : static_cast<int>(m_next_queue++ % m_queues.size());
+
+	m_pending_tasks++;
+	{
+		WorkerQueue& queue = *m_queues[queue_index];
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	m_queued_tasks++;
+
+	// taking the lock orders the notification after a worker's check of m_queued_tasks, so no wake-up is lost
+	{
+		std::lock_guard lock(m_wake_mutex);
+	}
+	m_wake_condition.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+	std::unique_lock lock(m_wake_mutex);
+	m_idle_condition.wait(lock, [this] { return m_pending_tasks == 0; });
+}
+
+void ThreadPool::worker_loop(const int worker_index)
+{
+	t_current_pool = this;
+	t_current_worker_index = worker_index;
+
+	Task task;
+	while (true)
+	{
+		if (pop_task(worker_index, task) || steal_task(worker_index, task))
+		{
+			m_queued_tasks--;
+			task();
+			task = nullptr;
+
+			if (m_pending_tasks.fetch_sub(1) == 1)
+			{
+				std::lock_guard lock(m_wake_mutex);
+				m_idle_condition.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock lock(m_wake_mutex);
+		m_wake_condition.wait(lock, [this] { return m_is_stopping || m_queued_tasks > 0; });
+
+		if (m_is_stopping && m_queued_tasks == 0)
+		{
+			return;
+		}
+	}
+}
+
+// the owner takes its newest task, which is the most likely to still be in cache
+bool ThreadPool::pop_task(const int worker_index, Task& task)
+{
+	WorkerQueue& queue = *m_queues[worker_index];
+	std::lock_guard lock(queue.mutex);
+
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+// thieves take the victim's oldest task
+bool ThreadPool::steal_task(const int worker_index, Task& task)
+{
+	const int queue_count = static_cast<int>(m_queues.size());
+
+	for (int offset = 1; offset < queue_count; ++offset)
+	{
+		WorkerQueue& queue = *m_queues[(worker_index + offset) % queue_count];
+		std::lock_guard lock(queue.mutex);
+
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @class ThreadPool
+ * @brief Work-stealing thread pool. Every worker owns a task queue, pops its own newest task first
+ * and steals the oldest task of another worker when its queue runs dry.
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	/**
+	 * @param thread_count Number of worker threads, defaults to the number of hardware threads
+	 */
+	explicit ThreadPool(int thread_count = static_cast<int>(std::thread::hardware_concurrency()));
+
+	/**
+	 * @brief Runs the tasks that are still queued, then joins the workers
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	int get_thread_count() const { return static_cast<int>(m_workers.size()); }
+
+	/**
+	 * @brief Queues a task. Tasks submitted from a worker go to that worker's queue, others are spread round-robin
+	 */
+	void submit(Task task);
+
+	/**
+	 * @brief Blocks until every submitted task finished running
+	 */
+	void wait_idle();
+
+	/**
+	 * @brief Returns the index of the calling worker in [0, get_thread_count()), or -1 if not called from one of the pool's workers.
+	 * Lets tasks use per-worker state without locking
+	 */
+	int get_current_worker_index() const { return t_current_pool == this ? t_current_worker_index : -1; }
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	vector<std::thread> m_workers;
+	vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake_condition;
+	std::condition_variable m_idle_condition;
+	bool m_is_stopping = false;
+
+	// tasks waiting in a queue
+	std::atomic<int> m_queued_tasks = 0;
+	// tasks waiting in a queue or running
+	std::atomic<int> m_pending_tasks = 0;
+	std::atomic<unsigned int> m_next_queue = 0;
+
+	inline static thread_local const ThreadPool* t_current_pool = nullptr;
+	inline static thread_local int t_current_worker_index = -1;
+
+	void worker_loop(int worker_index);
+	bool pop_task(int worker_index, Task& task);
+	bool steal_task(int worker_index, Task& task);
+};
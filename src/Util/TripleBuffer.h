@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TripleBuffer
+ * @brief Lock-free single producer, single consumer hand-over of the newest value.
+ * The writer fills the back buffer and publishes it with one atomic exchange, the reader takes the newest published
+ * buffer with another. Neither side ever waits, the reader skips values that were overwritten before it took them
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Writer side: the buffer to fill before the next publish, still holds what was published in it before
+	T& get_back() { return m_buffers[m_back]; }
+	int get_back_index() const { return m_back; }
+
+	/**
+	 * @brief Writer side: returns true if the last published buffer wasn't taken by the reader yet.
+	 * It may be taken right after the call, but once false it stays false until the next publish
+	 */
+	bool is_published_unread() const { return (m_shared.load(std::memory_order_acquire) & FRESH_BIT) != 0; }
+
+	/**
+	 * @brief Writer side: hands the back buffer to the reader and takes the buffer the reader isn't using
+	 */
+	void publish()
+	{
+		const uint8_t previous = m_shared.exchange(static_cast<uint8_t>(m_back | FRESH_BIT), std::memory_order_acq_rel);
+		m_back = previous & INDEX_MASK;
+	}
+
+	/**
+	 * @brief Reader side: takes the newest published buffer, if one was published since the last call
+	 * @return true iff the front buffer changed
+	 */
+	bool update()
+	{
+		if ((m_shared.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+		{
+			return false;
+		}
+
+		const uint8_t previous = m_shared.exchange(static_cast<uint8_t>(m_front), std::memory_order_acq_rel);
+		m_front = previous & INDEX_MASK;
+		return true;
+	}
+
+	// Reader side: the buffer taken by the last update
+	const T& get_front() const { return m_buffers[m_front]; }
+
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT = 0x4;
+
+	std::array<T, 3> m_buffers{};
+	int m_back = 0;
+	// index of the buffer between writer and reader, FRESH_BIT is set while the reader didn't take it yet
+	std::atomic<uint8_t> m_shared = 1;
+	int m_front = 2;
+};
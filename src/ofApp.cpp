@@ -1,22 +1,33 @@
 #include "ofApp.h"
 
+#include <algorithm>
 #include <string>
 
 using std::string;
 
 const string SET_TILES_FOLDER_PATH = "Tilesets/Knots";
 const string SET_XML_PATH = "Tilesets/Knots.xml";
+// compiled tile set and atlas, written on the first start and whenever the XML or the images change
+const string SET_CACHE_PATH = "Tilesets/Knots.wfct";
 
 //--------------------------------------------------------------
 void ofApp::setup(){
 	std::string xml_path = ofToDataPath(SET_XML_PATH, true);
 	std::string images_folder_path = ofToDataPath(SET_TILES_FOLDER_PATH, true);
+	std::string cache_path = ofToDataPath(SET_CACHE_PATH, true);
 	
-	m_tile_set = std::make_unique<TileSet>(xml_path, images_folder_path);
-	m_tile_map_generator = std::make_unique<TileMapGenerator>(*m_tile_set);
+	const float load_start = ofGetElapsedTimef();
+	m_tile_set = std::make_unique<TileSet>(xml_path, cache_path);
+	ofLogNotice("ofApp") << "Tile set loaded in " << ofGetElapsedTimef() - load_start << "s";
+
+	GenerationWorker::Settings settings;
+	settings.width = TILE_MAP_WIDTH;
+	settings.height = TILE_MAP_HEIGHT;
+	settings.backtracking.is_enabled = true;
+	settings.steps_per_second = get_animation_steps_per_second();
+	m_generation_worker = std::make_unique<GenerationWorker>(*m_tile_set, settings);
+	m_tile_map_renderer = std::make_unique<TileMapRenderer>(*m_tile_set, images_folder_path);
 
-	// m_tile_map_generator->generate_tile_map(TILE_MAP_WIDTH, TILE_MAP_HEIGHT);
-	m_tile_map_generator->init_tile_map(TILE_MAP_WIDTH, TILE_MAP_HEIGHT);
 	ofSetFrameRate(ANIMATION_FRAME_RATE);
 }
 
@@ -29,25 +40,20 @@ void ofApp::update(){
 void ofApp::draw(){
 	ofBackground(ofColor::black);
 
-	if (m_reset_pressed)
-	{
-		m_reset_pressed = false;
-		m_start_animation_pressed = false;
-		m_tile_map_generator->init_tile_map(TILE_MAP_WIDTH, TILE_MAP_HEIGHT);
-	}
+	const GenerationWorker::MapSnapshot& snapshot = m_generation_worker->acquire_snapshot();
 
-	if (m_erase_map_pressed)
+	if (snapshot.contradiction_restarts != m_logged_contradiction_restarts)
 	{
-		m_erase_map_pressed = false;
-		m_tile_map_generator->init_tile_map(TILE_MAP_WIDTH, TILE_MAP_HEIGHT);
+		m_logged_contradiction_restarts = snapshot.contradiction_restarts;
+		ofLogWarning() << "Contradiction, backtracking limits reached, restarted the map";
 	}
 
-	if (m_start_animation_pressed && !m_tile_map_generator->is_tile_map_finished)
-	{
-		m_tile_map_generator->generate_single_step();
-	}
+	m_tile_map_renderer->draw_tile_map(snapshot);
+}
 
-	m_tile_map_generator->draw_tile_map();
+//--------------------------------------------------------------
+double ofApp::get_animation_steps_per_second() const {
+	return std::max(1.0, TILE_MAP_WIDTH * TILE_MAP_HEIGHT / static_cast<double>(ANIMATION_SECONDS));
 }
 
 //--------------------------------------------------------------
@@ -58,20 +64,33 @@ void ofApp::exit(){
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
 	if (key == OF_KEY_RIGHT) {
-		m_start_animation_pressed = true;
+		m_generation_worker->set_running(true);
 	}
 
+	// erase and reset cancel the map being generated, reset also stops the animation
 	if (key == 'e') {
-		m_erase_map_pressed = true;
+		m_generation_worker->request_restart();
 	}
 
 	if (key == 'r') {
-		m_reset_pressed = true;
+		m_generation_worker->set_running(false);
+		m_generation_worker->request_restart();
+	}
+
+	// fast-forward at full speed while held
+	if (key == 'f' && !m_fast_forward_pressed) {
+		m_fast_forward_pressed = true;
+		m_generation_worker->set_steps_per_second(0);
+		m_generation_worker->set_running(true);
 	}
 }
 
 //--------------------------------------------------------------
 void ofApp::keyReleased(int key){
+	if (key == 'f') {
+		m_fast_forward_pressed = false;
+		m_generation_worker->set_steps_per_second(get_animation_steps_per_second());
+	}
 
 }
 
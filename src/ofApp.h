@@ -1,7 +1,8 @@
 #pragma once
 
 #include "Data/TileSet.h"
-#include <TileMapGenerator.h>
+#include "Generation/GenerationWorker.h"
+#include "Rendering/TileMapRenderer.h"
 
 #include "ofMain.h"
 
@@ -30,11 +31,16 @@ class ofApp : public ofBaseApp{
 		const int TILE_MAP_WIDTH = 12;
 		const int TILE_MAP_HEIGHT = 9;
 		const int ANIMATION_FRAME_RATE = 60;
+		// the animation collapses cells at a rate that finishes in about this long, whatever the map size
+		const float ANIMATION_SECONDS = 3;
 
 		std::unique_ptr<TileSet> m_tile_set;
-		std::unique_ptr<TileMapGenerator> m_tile_map_generator;
+		// generates on its own thread, the draw loop only consumes its snapshots
+		std::unique_ptr<GenerationWorker> m_generation_worker;
+		std::unique_ptr<TileMapRenderer> m_tile_map_renderer;
 
-		bool m_start_animation_pressed = false;
-		bool m_erase_map_pressed = false;
-		bool m_reset_pressed = false;
+		bool m_fast_forward_pressed = false;
+		int m_logged_contradiction_restarts = 0;
+
+		double get_animation_steps_per_second() const;
 };
@@ -0,0 +1,579 @@
+// Generation throughput benchmark, prints JSON results that can be diffed between commits.
+// Runs generate_tile_map over a matrix of map sizes, tile sets (Knots plus synthetic sets) and fixed seeds.
+// Usage: wfc_bench [--knots bin/data/Tilesets/Knots.xml] [--sizes 16,32,64,128,256,512,1024]
+//                  [--tiles 10,100,500,2000] [--seeds 1,2,3] [--propagators ac4,scan,specialized]
+//                  [--max-cell-tiles 1000000000] [--backtracking off|on] [--region-size 0] [--output results.json]
+//                  [--isa scalar|sse4.2|avx2] [--kernels on|off]
+// Runs where cells * tiles exceeds max-cell-tiles are skipped and listed as such.
+// Each configuration runs in a forked child process, so its peak RSS is its own.
+// --isa selects the DomainKernels used by the generators, by default the best one the CPU supports.
+// Unless --kernels is off the kernels of every supported instruction set are also timed on random domains as wide as
+// each synthetic tile set.
+// With --region-size N every generated map also has N x N regions at random positions regenerated, as an editor would.
+// "specialized" runs the TileMapSolver compiled for the tile set's domain width, it has no phase times or counters.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Data/Domain.h"
+#include "Data/TileSet.h"
+#include "Generation/TileMapSolver.h"
+#include "TileMapGenerator.h"
+#include "Util/DomainKernels.h"
+#include "Util/Random.h"
+
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+	string knots_path = "bin/data/Tilesets/Knots.xml";
+	vector<int> sizes{16, 32, 64, 128, 256, 512, 1024};
+	vector<int> synthetic_tile_counts{10, 100, 500, 2000};
+	vector<uint64_t> seeds{1, 2, 3};
+	// "ac4", "scan" or "specialized"
+	vector<string> propagators{"ac4", "scan"};
+	double max_cell_tiles = 1e9;
+	bool is_backtracking_enabled = false;
+	// side of the regions regenerated after each map, 0 to skip
+	int region_size = 0;
+	DomainKernels::Isa isa = DomainKernels::get_supported_isa();
+	bool is_kernel_bench_enabled = true;
+	string output_path;
+};
+
+struct NamedTileSet
+{
+	string name;
+	std::unique_ptr<TileSet> tile_set;
+};
+
+struct RunStats
+{
+	int runs = 0;
+	int contradictions = 0;
+	int backtracks = 0;
+	int restarts = 0;
+	double init_seconds = 0;
+	double total_seconds = 0;
+	double collapsed_cells = 0;
+	double selection_seconds = 0;
+	double collapse_seconds = 0;
+	double propagation_seconds = 0;
+	int64_t tiles_banned = 0;
+	int queue_high_water = 0;
+	int regions = 0;
+	int region_contradictions = 0;
+	double region_seconds = 0;
+};
+
+static vector<int> parse_int_list(const string& list)
+{
+	vector<int> values;
+	std::stringstream stream(list);
+	string item;
+	while (std::getline(stream, item, ','))
+	{
+		values.push_back(std::atoi(item.c_str()));
+	}
+
+	return values;
+}
+
+// Parses 64-bit seeds like wfc_cli's --seed, returns false if one isn't a number or doesn't fit
+static bool parse_seed_list(const string& list, vector<uint64_t>& seeds)
+{
+	seeds.clear();
+	std::stringstream stream(list);
+	string item;
+	while (std::getline(stream, item, ','))
+	{
+		try
+		{
+			seeds.push_back(std::stoull(item));
+		}
+		catch (const std::logic_error&)
+		{
+			return false;
+		}
+	}
+
+	return !seeds.empty();
+}
+
+static bool parse_options(const int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i += 2)
+	{
+		const string key = argv[i];
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+		const string value = argv[i + 1];
+
+		if (key == "--knots") options.knots_path = value;
+		else if (key == "--sizes") options.sizes = parse_int_list(value);
+		else if (key == "--tiles") options.synthetic_tile_counts = parse_int_list(value);
+		else if (key == "--max-cell-tiles") options.max_cell_tiles = std::atof(value.c_str());
+		else if (key == "--output") options.output_path = value;
+		else if (key == "--region-size") options.region_size = std::atoi(value.c_str());
+		else if (key == "--kernels")
+		{
+			if (value != "on" && value != "off") return false;
+			options.is_kernel_bench_enabled = value == "on";
+		}
+		else if (key == "--isa")
+		{
+			if (value == "scalar") options.isa = DomainKernels::Isa::Scalar;
+			else if (value == "sse4.2") options.isa = DomainKernels::Isa::Sse42;
+			else if (value == "avx2") options.isa = DomainKernels::Isa::Avx2;
+			else return false;
+		}
+		else if (key == "--backtracking")
+		{
+			if (value != "on" && value != "off") return false;
+			options.is_backtracking_enabled = value == "on";
+		}
+		else if (key == "--seeds")
+		{
+			if (!parse_seed_list(value, options.seeds)) return false;
+		}
+		else if (key == "--propagators")
+		{
+			options.propagators.clear();
+			std::stringstream stream(value);
+			string item;
+			while (std::getline(stream, item, ','))
+			{
+				if (item != "ac4" && item != "scan" && item != "specialized") return false;
+				options.propagators.push_back(item);
+			}
+		}
+		else return false;
+	}
+
+	return true;
+}
+
+// Tiles with random edges from a small alphabet. One tile per label has that label on all sides,
+// so every label has at least one tile that can continue it
+static std::unique_ptr<TileSet> make_synthetic_tile_set(const int tile_count)
+{
+	constexpr int EDGE_LABELS = 3;
+
+	Xoshiro256 random(tile_count);
+
+	unordered_map<string, TileSet::TileData> tiles;
+	for (int i = 0; i < tile_count; ++i)
+	{
+		TileSet::TileData tile{TileSet::SYMMETRY_TYPE_X, 1, vector<string>(TileSet::NUMBER_OF_SIDES), {}, 0};
+		for (string& edge : tile.edges)
+		{
+			edge = std::to_string(i < EDGE_LABELS ? i : random_below(random, EDGE_LABELS));
+		}
+		tiles[string("s").append(std::to_string(i))] = tile;
+	}
+
+	return std::make_unique<TileSet>(tiles);
+}
+
+static long get_peak_rss_kb(const rusage& usage)
+{
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// Runs a configuration in a forked child and reads its peak RSS from wait4, as the process-wide high-water mark
+// would report the largest configuration run so far. The child starts with the parent's pages, i.e. the tile sets.
+// Returns nullopt when the child failed
+static std::optional<RunStats> run_in_child(const std::function<RunStats()>& run_configuration, long& peak_rss_kb)
+{
+	static_assert(std::is_trivially_copyable_v<RunStats>);
+
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		return std::nullopt;
+	}
+
+	const pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return std::nullopt;
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		const RunStats stats = run_configuration();
+		const bool is_written = write(fds[1], &stats, sizeof(stats)) == static_cast<ssize_t>(sizeof(stats));
+		close(fds[1]);
+		// skips the parent's atexit handlers and stream buffers
+		_exit(is_written ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	RunStats stats;
+	size_t bytes_read = 0;
+	while (bytes_read < sizeof(stats))
+	{
+		const ssize_t count = read(fds[0], reinterpret_cast<char*>(&stats) + bytes_read, sizeof(stats) - bytes_read);
+		if (count <= 0)
+		{
+			break;
+		}
+		bytes_read += static_cast<size_t>(count);
+	}
+	close(fds[0]);
+
+	int status = 0;
+	rusage usage{};
+	if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || bytes_read != sizeof(stats))
+	{
+		return std::nullopt;
+	}
+
+	peak_rss_kb = get_peak_rss_kb(usage);
+	return stats;
+}
+
+static double seconds_since(const Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Regenerates regions of the finished map, the time per region should depend on the region's size only
+static void run_regions(TileMapGenerator& generator, const uint64_t seed, const int size, const Options& options, RunStats& stats)
+{
+	constexpr int REGIONS_PER_MAP = 20;
+
+	Xoshiro256 random(seed);
+	const int region_size = std::min(options.region_size, size);
+
+	for (int i = 0; i < REGIONS_PER_MAP; ++i)
+	{
+		const int x = random_below(random, size - region_size + 1);
+		const int y = random_below(random, size - region_size + 1);
+
+		const Clock::time_point start = Clock::now();
+		const TileMapGenerator::GenerationResult result = generator.regenerate_region(x, y, region_size, region_size);
+		stats.region_seconds += seconds_since(start);
+
+		stats.regions++;
+		if (result.status == TileMapGenerator::GenerationStatus::Contradiction)
+		{
+			// the rest of the regions would start from a broken map
+			stats.region_contradictions++;
+			return;
+		}
+	}
+}
+
+static RunStats run(const TileSet& tile_set, const TileMapGenerator::PropagatorType propagator, const int size, const Options& options)
+{
+	RunStats stats;
+	TileMapGenerator generator(tile_set, propagator);
+	generator.set_stats_mode(GenerationStats::Mode::Aggregate);
+
+	TileMapGenerator::BacktrackingSettings backtracking;
+	backtracking.is_enabled = options.is_backtracking_enabled;
+	generator.set_backtracking(backtracking);
+
+	for (const uint64_t seed : options.seeds)
+	{
+		generator.set_seed(seed);
+
+		const Clock::time_point start = Clock::now();
+		generator.init_tile_map(size, size);
+		stats.init_seconds += seconds_since(start);
+
+		while (!generator.is_tile_map_finished())
+		{
+			generator.generate_single_step();
+		}
+		stats.total_seconds += seconds_since(start);
+
+		stats.runs++;
+		stats.collapsed_cells += static_cast<double>(size) * size - generator.get_remaining_cells();
+		if (generator.get_result().status == TileMapGenerator::GenerationStatus::Contradiction)
+		{
+			stats.contradictions++;
+		}
+		stats.backtracks += generator.get_backtrack_count();
+		stats.restarts += generator.get_restart_count();
+
+		const GenerationStats::Totals& totals = generator.get_stats().get_totals();
+		stats.selection_seconds += totals.selection_seconds;
+		stats.collapse_seconds += totals.collapse_seconds;
+		stats.propagation_seconds += totals.propagation_seconds;
+		stats.tiles_banned += totals.tiles_banned;
+		stats.queue_high_water = std::max(stats.queue_high_water, totals.queue_high_water);
+
+		if (options.region_size > 0 && generator.get_result().status == TileMapGenerator::GenerationStatus::Finished)
+		{
+			run_regions(generator, seed, size, options, stats);
+		}
+	}
+
+	return stats;
+}
+
+static RunStats run_specialized(const TileSet& tile_set, const int size, const Options& options)
+{
+	RunStats stats;
+	const std::unique_ptr<TileMapSolver> solver = TileMapSolver::create(tile_set);
+
+	for (const uint64_t seed : options.seeds)
+	{
+		solver->set_seed(seed);
+
+		const Clock::time_point start = Clock::now();
+		const TileMapGenerator::GenerationResult result = solver->generate_tile_map(size, size);
+		stats.total_seconds += seconds_since(start);
+
+		stats.runs++;
+		if (result.status == TileMapGenerator::GenerationStatus::Contradiction)
+		{
+			stats.contradictions++;
+		}
+		for (const int tile_id : solver->get_collapsed_ids())
+		{
+			stats.collapsed_cells += tile_id >= 0 ? 1 : 0;
+		}
+	}
+
+	return stats;
+}
+
+// Nanoseconds per call of func(i) for i cycling through count inputs, over at least MIN_SECONDS
+template <typename Func>
+static double time_kernel(const int count, Func&& func)
+{
+	constexpr double MIN_SECONDS = 0.02;
+
+	int64_t calls = 0;
+	const Clock::time_point start = Clock::now();
+	double seconds = 0;
+	while (seconds < MIN_SECONDS)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			func(i);
+		}
+		calls += count;
+		seconds = seconds_since(start);
+	}
+
+	return seconds * 1e9 / static_cast<double>(calls);
+}
+
+// Times every kernel for each supported instruction set on random domains of each synthetic tile count's width
+static void run_kernels(const Options& options, std::ostringstream& json)
+{
+	constexpr int DOMAIN_COUNT = 256;
+
+	json << ",\n  \"kernels\": [";
+	bool is_first = true;
+
+	for (const int tile_count : options.synthetic_tile_counts)
+	{
+		const int word_count = Domain::words_for(tile_count);
+		Xoshiro256 random(tile_count);
+
+		// domains with about half the tiles, and masks that are supersets of them so changed-detection scans all words
+		vector<uint64_t> domains(static_cast<size_t>(DOMAIN_COUNT) * word_count);
+		vector<uint64_t> supersets(domains.size());
+		for (size_t i = 0; i < domains.size(); ++i)
+		{
+			domains[i] = random();
+			supersets[i] = domains[i] | random();
+		}
+		vector<uint64_t> scratch(domains.size());
+
+		vector<double> weights(static_cast<size_t>(word_count) * Domain::BITS_PER_WORD);
+		vector<double> weight_log_weights(weights.size());
+		for (size_t i = 0; i < weights.size(); ++i)
+		{
+			weights[i] = 0.1 + random_unit(random);
+			weight_log_weights[i] = weights[i] * std::log(weights[i]);
+		}
+
+		for (int isa = 0; isa <= static_cast<int>(DomainKernels::get_supported_isa()); ++isa)
+		{
+			DomainKernels::set_isa(static_cast<DomainKernels::Isa>(isa));
+
+			auto domain = [&](const int i) { return domains.data() + static_cast<size_t>(i) * word_count; };
+			auto superset = [&](const int i) { return supersets.data() + static_cast<size_t>(i) * word_count; };
+			auto scratch_domain = [&](const int i) { return scratch.data() + static_cast<size_t>(i) * word_count; };
+
+			// results are summed so the calls can't be optimized away
+			int64_t checksum = 0;
+			const double union_ns = time_kernel(DOMAIN_COUNT, [&](const int i)
+			{
+				DomainKernels::union_into(scratch_domain(i), domain(i), word_count);
+			});
+			const double intersect_ns = time_kernel(DOMAIN_COUNT, [&](const int i)
+			{
+				checksum += DomainKernels::intersect(scratch_domain(i), superset(i), word_count);
+			});
+			const double changed_ns = time_kernel(DOMAIN_COUNT, [&](const int i)
+			{
+				checksum += DomainKernels::is_changed_by(domain(i), superset(i), word_count);
+			});
+			const double popcount_ns = time_kernel(DOMAIN_COUNT, [&](const int i)
+			{
+				checksum += DomainKernels::popcount(domain(i), word_count);
+			});
+			double entropy_sum = 0;
+			const double entropy_ns = time_kernel(DOMAIN_COUNT, [&](const int i)
+			{
+				entropy_sum += DomainKernels::entropy(domain(i), word_count, weights.data(), weight_log_weights.data());
+			});
+
+			json << (is_first ? "\n" : ",\n") << "    {\"isa\": \"" << DomainKernels::get_isa_name(DomainKernels::get_isa()) << "\", \"tiles\": " << tile_count
+				 << ", \"words\": " << word_count
+				 << ", \"union_ns\": " << union_ns
+				 << ", \"intersect_ns\": " << intersect_ns
+				 << ", \"changed_ns\": " << changed_ns
+				 << ", \"popcount_ns\": " << popcount_ns
+				 << ", \"weighted_entropy_ns\": " << entropy_ns
+				 << ", \"checksum\": " << checksum + static_cast<int64_t>(entropy_sum) << "}";
+			is_first = false;
+		}
+	}
+
+	json << "\n  ]";
+	DomainKernels::set_isa(options.isa);
+}
+
+int main(const int argc, char** argv)
+{
+	Options options;
+	if (!parse_options(argc, argv, options))
+	{
+		std::cerr << "Usage: wfc_bench [--knots <xml>] [--sizes 16,64,...] [--tiles 10,100,...] [--seeds 1,2,...]\n"
+				  << "                 [--propagators ac4,scan,specialized] [--max-cell-tiles N] [--backtracking off|on]\n"
+				  << "                 [--region-size 0] [--output results.json] [--isa scalar|sse4.2|avx2] [--kernels on|off]\n";
+		return EXIT_FAILURE;
+	}
+
+	DomainKernels::set_isa(options.isa);
+
+	vector<NamedTileSet> tile_sets;
+	tile_sets.push_back(NamedTileSet{"knots", std::make_unique<TileSet>(options.knots_path)});
+	for (const int tile_count : options.synthetic_tile_counts)
+	{
+		tile_sets.push_back(NamedTileSet{"synthetic_" + std::to_string(tile_count), make_synthetic_tile_set(tile_count)});
+	}
+
+	std::ostringstream json;
+	json << "{\n  \"isa\": \"" << DomainKernels::get_isa_name(DomainKernels::get_isa()) << "\",\n  \"results\": [";
+	bool is_first = true;
+
+	for (const NamedTileSet& named_tile_set : tile_sets)
+	{
+		const int tile_count = named_tile_set.tile_set->get_tile_count();
+		if (tile_count == 0)
+		{
+			std::cerr << "Skipping empty tile set " << named_tile_set.name << std::endl;
+			continue;
+		}
+
+		for (const string& propagator_name : options.propagators)
+		{
+
+			for (const int size : options.sizes)
+			{
+				json << (is_first ? "\n" : ",\n") << "    {\"tileset\": \"" << named_tile_set.name << "\", \"tiles\": " << tile_count
+					 << ", \"width\": " << size << ", \"height\": " << size << ", \"propagator\": \"" << propagator_name << "\"";
+				is_first = false;
+
+				if (static_cast<double>(size) * size * tile_count > options.max_cell_tiles)
+				{
+					json << ", \"skipped\": true}";
+					continue;
+				}
+
+				std::cerr << named_tile_set.name << " " << propagator_name << " " << size << "x" << size << std::endl;
+				long peak_rss_kb = 0;
+				const std::optional<RunStats> child_stats = run_in_child([&]
+				{
+					return propagator_name == "specialized" ? run_specialized(*named_tile_set.tile_set, size, options)
+						: run(*named_tile_set.tile_set, propagator_name == "ac4" ? TileMapGenerator::PropagatorType::SupportCount : TileMapGenerator::PropagatorType::DomainScan, size, options);
+				}, peak_rss_kb);
+				if (!child_stats.has_value())
+				{
+					std::cerr << "Run failed" << std::endl;
+					json << ", \"failed\": true}";
+					continue;
+				}
+				const RunStats& stats = child_stats.value();
+
+				json << ", \"runs\": " << stats.runs
+					 << ", \"contradiction_rate\": " << static_cast<double>(stats.contradictions) / stats.runs
+					 << ", \"backtracks\": " << stats.backtracks
+					 << ", \"restarts\": " << stats.restarts
+					 << ", \"cells_per_second\": " << stats.collapsed_cells / stats.total_seconds
+					 << ", \"total_seconds\": " << stats.total_seconds
+					 << ", \"init_seconds\": " << stats.init_seconds
+					 << ", \"selection_seconds\": " << stats.selection_seconds
+					 << ", \"collapse_seconds\": " << stats.collapse_seconds
+					 << ", \"propagation_seconds\": " << stats.propagation_seconds
+					 << ", \"tiles_banned\": " << stats.tiles_banned
+					 << ", \"queue_high_water\": " << stats.queue_high_water;
+				if (stats.regions > 0)
+				{
+					json << ", \"region_size\": " << std::min(options.region_size, size)
+						 << ", \"regions\": " << stats.regions
+						 << ", \"region_contradictions\": " << stats.region_contradictions
+						 << ", \"seconds_per_region\": " << stats.region_seconds / stats.regions;
+				}
+				json << ", \"peak_rss_kb\": " << peak_rss_kb << "}";
+			}
+		}
+	}
+
+	json << "\n  ]";
+	if (options.is_kernel_bench_enabled)
+	{
+		run_kernels(options, json);
+	}
+	json << "\n}\n";
+
+	if (options.output_path.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream(options.output_path) << json.str();
+	}
+
+	return EXIT_SUCCESS;
+}
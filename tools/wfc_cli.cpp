@@ -0,0 +1,395 @@
+// Headless map generation: loads a tile set XML and writes generated tile ID grids, no openFrameworks needed.
+// Usage: wfc_cli --tileset <xml> [--width 64] [--height 64] [--seed 0] [--count 1]
+//                [--format csv|bin] [--output map] [--propagator scan|ac4] [--max-attempts 10] [--threads N]
+//                [--backtracking off|on] [--cache <file>] [--stats off|summary|trace] [--out-of-core <state file>]
+//                [--parallel off|on] [--solver generic|specialized] [--topology square|torus|hex|voxel] [--depth 1]
+//        wfc_cli --sample <ppm> [--pattern-size 3] [--symmetry 8] [--periodic-input on|off] [same options as above]
+// Maps are generated in parallel on N threads (default: hardware threads), map i is generated with seed + i
+// and written to <output>_<i>.csv/.bin, tile names are written to <output>.tiles.
+// With --cache the compiled tile set is loaded from that file, which is (re)written when missing or stale.
+// With --stats summary the generator's counters are written to <output>_<i>.stats.json,
+// --stats trace also writes a Chrome trace-event timeline of every step to <output>_<i>.trace.json.
+// With --out-of-core the cell state lives in the given memory-mapped file instead of memory, for maps larger than RAM.
+// Maps are then generated one after another, --max-attempts applies per block, and the propagator, backtracking,
+// threads and stats options don't apply
+// With --solver specialized maps are generated by the solver compiled for the tile set's domain width, which picks
+// the same tiles as --propagator scan, the propagator, backtracking and stats options don't apply.
+// --topology other than square implies the specialized solver: torus wraps around both axes, hex and voxel need a
+// tile set with 6 sides. Voxel maps have --depth layers, written one after another as height * depth rows.
+// --out-of-core and --parallel only generate square maps
+// With --parallel on maps are generated one after another, each one split into blocks that are solved on all threads,
+// for single maps too large to generate quickly on one core. --max-attempts applies per block, and the propagator,
+// backtracking and stats options don't apply. The maps only depend on the seed, not on the number of threads
+// With --sample the tiles are the --pattern-size patterns of the sample image and of up to --symmetry of its rotations
+// and reflections (overlapping model), each map is also rendered to <output>_<i>.ppm. --cache doesn't apply
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "Data/Bitmap.h"
+#include "Data/OverlappingModel.h"
+#include "Data/TileSet.h"
+#include "Data/TileMapWriter.h"
+#include "Generation/BatchGenerator.h"
+#include "Generation/OutOfCoreGenerator.h"
+#include "Generation/ParallelTileMapGenerator.h"
+#include "Generation/TileMapSolver.h"
+#include "TileMapGenerator.h"
+
+using std::string;
+
+struct Options
+{
+	string tileset_path;
+	string sample_path;
+	OverlappingModel::Settings overlapping_settings;
+	string cache_path;
+	string out_of_core_path;
+	string output_prefix = "map";
+	int width = 64;
+	int height = 64;
+	uint64_t seed = 0;
+	int count = 1;
+	int max_attempts = 10;
+	int threads = static_cast<int>(std::thread::hardware_concurrency());
+	TileMapWriter::Format format = TileMapWriter::Format::Csv;
+	TileMapGenerator::PropagatorType propagator = TileMapGenerator::PropagatorType::DomainScan;
+	bool is_backtracking_enabled = false;
+	bool is_parallel = false;
+	bool is_specialized = false;
+	TileMapSolver::GridType grid_type = TileMapSolver::GridType::Square;
+	int depth = 1;
+	GenerationStats::Mode stats_mode = GenerationStats::Mode::Disabled;
+};
+
+static void print_usage()
+{
+	std::cerr << "Usage: wfc_cli --tileset <xml> [--width 64] [--height 64] [--seed 0] [--count 1]\n"
+			  << "               [--format csv|bin] [--output map] [--propagator scan|ac4] [--max-attempts 10]\n"
+			  << "               [--threads N] [--backtracking off|on] [--cache <file>] [--stats off|summary|trace]\n"
+			  << "               [--out-of-core <state file>] [--parallel off|on]\n"
+			  << "               [--solver generic|specialized] [--topology square|torus|hex|voxel] [--depth 1]\n"
+			  << "       wfc_cli --sample <ppm> [--pattern-size 3] [--symmetry 8] [--periodic-input on|off] [same options]\n";
+}
+
+static bool parse_options(const int argc, char** argv, Options& options)
+{
+	std::unordered_map<string, string> values;
+	for (int i = 1; i < argc; i += 2)
+	{
+		const string key = argv[i];
+		if (key.rfind("--", 0) != 0 || i + 1 >= argc)
+		{
+			return false;
+		}
+		values[key.substr(2)] = argv[i + 1];
+	}
+
+	// tiles come from either a tile set or a sample image
+	if (values.contains("tileset") == values.contains("sample"))
+	{
+		return false;
+	}
+
+	if (values.contains("tileset")) options.tileset_path = values["tileset"];
+	if (values.contains("sample")) options.sample_path = values["sample"];
+	if (values.contains("pattern-size")) options.overlapping_settings.pattern_size = std::atoi(values["pattern-size"].c_str());
+	if (values.contains("symmetry")) options.overlapping_settings.symmetry = std::atoi(values["symmetry"].c_str());
+
+	if (values.contains("periodic-input"))
+	{
+		if (values["periodic-input"] == "on") options.overlapping_settings.is_periodic_input = true;
+		else if (values["periodic-input"] == "off") options.overlapping_settings.is_periodic_input = false;
+		else return false;
+	}
+
+	if (values.contains("output")) options.output_prefix = values["output"];
+	if (values.contains("cache")) options.cache_path = values["cache"];
+	if (values.contains("out-of-core")) options.out_of_core_path = values["out-of-core"];
+	if (values.contains("width")) options.width = std::atoi(values["width"].c_str());
+	if (values.contains("height")) options.height = std::atoi(values["height"].c_str());
+	if (values.contains("seed"))
+	{
+		try
+		{
+			options.seed = std::stoull(values["seed"]);
+		}
+		catch (const std::logic_error&)
+		{
+			return false;
+		}
+	}
+	if (values.contains("count")) options.count = std::atoi(values["count"].c_str());
+	if (values.contains("max-attempts")) options.max_attempts = std::atoi(values["max-attempts"].c_str());
+	if (values.contains("threads")) options.threads = std::atoi(values["threads"].c_str());
+
+	if (values.contains("format"))
+	{
+		if (values["format"] == "csv") options.format = TileMapWriter::Format::Csv;
+		else if (values["format"] == "bin") options.format = TileMapWriter::Format::Binary;
+		else return false;
+	}
+
+	if (values.contains("propagator"))
+	{
+		if (values["propagator"] == "ac4") options.propagator = TileMapGenerator::PropagatorType::SupportCount;
+		else if (values["propagator"] == "scan") options.propagator = TileMapGenerator::PropagatorType::DomainScan;
+		else return false;
+	}
+
+	if (values.contains("backtracking"))
+	{
+		if (values["backtracking"] == "on") options.is_backtracking_enabled = true;
+		else if (values["backtracking"] == "off") options.is_backtracking_enabled = false;
+		else return false;
+	}
+
+	if (values.contains("parallel"))
+	{
+		if (values["parallel"] == "on") options.is_parallel = true;
+		else if (values["parallel"] == "off") options.is_parallel = false;
+		else return false;
+	}
+
+	if (values.contains("solver"))
+	{
+		if (values["solver"] == "specialized") options.is_specialized = true;
+		else if (values["solver"] == "generic") options.is_specialized = false;
+		else return false;
+	}
+
+	if (values.contains("topology"))
+	{
+		if (values["topology"] == "square") options.grid_type = TileMapSolver::GridType::Square;
+		else if (values["topology"] == "torus") options.grid_type = TileMapSolver::GridType::Toroidal;
+		else if (values["topology"] == "hex") options.grid_type = TileMapSolver::GridType::Hex;
+		else if (values["topology"] == "voxel") options.grid_type = TileMapSolver::GridType::Voxel;
+		else return false;
+
+		options.is_specialized |= options.grid_type != TileMapSolver::GridType::Square;
+	}
+	if (values.contains("depth")) options.depth = std::atoi(values["depth"].c_str());
+
+	if (values.contains("stats"))
+	{
+		if (values["stats"] == "off") options.stats_mode = GenerationStats::Mode::Disabled;
+		else if (values["stats"] == "summary") options.stats_mode = GenerationStats::Mode::Aggregate;
+		else if (values["stats"] == "trace") options.stats_mode = GenerationStats::Mode::Trace;
+		else return false;
+	}
+
+	return options.width > 0 && options.height > 0 && options.count > 0 && options.max_attempts > 0 && options.threads > 0 && options.depth > 0
+		&& options.overlapping_settings.pattern_size > 0 && options.overlapping_settings.symmetry > 0;
+}
+
+// Writes the map's pixels next to its tile IDs when the tiles are the patterns of a sample
+static void write_render(const OverlappingModel* overlapping_model, const string& map_prefix, const vector<int>& tile_ids, const Options& options)
+{
+	if (overlapping_model != nullptr)
+	{
+		overlapping_model->render(tile_ids, options.width, options.height).write_ppm(map_prefix + ".ppm");
+	}
+}
+
+// Generates the maps one after another with the cell state in a memory-mapped file, returns the number of failed maps
+static int generate_out_of_core(const TileSet& tile_set, const Options& options)
+{
+	OutOfCoreGenerator generator(tile_set, options.out_of_core_path);
+	generator.set_max_block_attempts(options.max_attempts);
+
+	int failed_maps = 0;
+	for (int map_idx = 0; map_idx < options.count; ++map_idx)
+	{
+		generator.set_seed(options.seed + map_idx);
+		const TileMapGenerator::GenerationResult result = generator.generate(options.width, options.height);
+		if (result.status != TileMapGenerator::GenerationStatus::Finished)
+		{
+			std::cerr << "Map " << map_idx << ": " << (result.contradiction_idx.has_value() ? "contradiction in all block attempts" : "no state file") << std::endl;
+			failed_maps++;
+			continue;
+		}
+
+		const string path = options.output_prefix + "_" + std::to_string(map_idx) + TileMapWriter::get_extension(options.format);
+		if (!generator.write(path, options.format))
+		{
+			failed_maps++;
+		}
+	}
+
+	return failed_maps;
+}
+
+// Generates the maps one after another, each on all threads, returns the number of failed maps
+static int generate_parallel(const TileSet& tile_set, const OverlappingModel* overlapping_model, const Options& options)
+{
+	ParallelTileMapGenerator generator(tile_set, options.threads);
+	generator.set_max_block_attempts(options.max_attempts);
+
+	int failed_maps = 0;
+	for (int map_idx = 0; map_idx < options.count; ++map_idx)
+	{
+		generator.set_seed(options.seed + map_idx);
+		const TileMapGenerator::GenerationResult result = generator.generate_tile_map(options.width, options.height);
+		if (result.status != TileMapGenerator::GenerationStatus::Finished)
+		{
+			std::cerr << "Map " << map_idx << ": contradiction in all block attempts" << std::endl;
+			failed_maps++;
+			continue;
+		}
+
+		const string map_prefix = options.output_prefix + "_" + std::to_string(map_idx);
+		const vector<int> tile_ids = generator.get_collapsed_ids();
+		if (!TileMapWriter::write(map_prefix + TileMapWriter::get_extension(options.format), options.format, options.width, options.height, tile_set.get_tile_count(), tile_ids))
+		{
+			failed_maps++;
+		}
+		write_render(overlapping_model, map_prefix, tile_ids, options);
+	}
+
+	return failed_maps;
+}
+
+int main(const int argc, char** argv)
+{
+	Options options;
+	if (!parse_options(argc, argv, options))
+	{
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	// the block solvers of --out-of-core and --parallel only know bounded square grids
+	if ((!options.out_of_core_path.empty() || options.is_parallel) && options.grid_type != TileMapSolver::GridType::Square)
+	{
+		std::cerr << "--topology " << (options.grid_type == TileMapSolver::GridType::Toroidal ? "torus" : options.grid_type == TileMapSolver::GridType::Hex ? "hex" : "voxel")
+				  << " can't be combined with " << (options.is_parallel ? "--parallel on" : "--out-of-core") << ", only square maps are generated in blocks" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::optional<OverlappingModel> overlapping_model;
+	if (!options.sample_path.empty())
+	{
+		const std::optional<Bitmap> sample = Bitmap::load_ppm(options.sample_path);
+		if (!sample.has_value())
+		{
+			return EXIT_FAILURE;
+		}
+
+		const auto start_time = std::chrono::steady_clock::now();
+		overlapping_model.emplace(sample.value(), options.overlapping_settings);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		std::cerr << "Extracted " << overlapping_model->get_pattern_count() << " patterns of " << overlapping_model->get_palette().size()
+				  << " colors in " << seconds << "s" << std::endl;
+	}
+
+	const TileSet tile_set = overlapping_model.has_value() ? overlapping_model->make_tile_set()
+		: options.cache_path.empty() ? TileSet(options.tileset_path) : TileSet(options.tileset_path, options.cache_path);
+	if (tile_set.get_tile_count() == 0)
+	{
+		std::cerr << "No tiles loaded from " << (overlapping_model.has_value() ? options.sample_path : options.tileset_path) << std::endl;
+		return EXIT_FAILURE;
+	}
+	const OverlappingModel* sample_model = overlapping_model.has_value() ? &overlapping_model.value() : nullptr;
+
+	// only the specialized solver handles grids other than square ones
+	const int number_of_sides = options.is_specialized ? TileMapSolver::get_number_of_sides(options.grid_type) : TileSet::NUMBER_OF_SIDES;
+	if (number_of_sides != tile_set.get_number_of_sides())
+	{
+		std::cerr << "The grid's cells have " << number_of_sides << " sides, the tile set's tiles " << tile_set.get_number_of_sides() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TileMapWriter::write_tile_names(options.output_prefix + ".tiles", tile_set.get_tile_names());
+
+	if (!options.out_of_core_path.empty())
+	{
+		const auto start_time = std::chrono::steady_clock::now();
+		const int failed_maps = generate_out_of_core(tile_set, options);
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		const double cells = static_cast<double>(options.width) * options.height * options.count;
+		std::cerr << "Generated " << options.count - failed_maps << "/" << options.count << " maps out of core in " << seconds << "s ("
+				  << cells / seconds << " cells/s)" << std::endl;
+
+		return failed_maps == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (options.is_parallel)
+	{
+		const auto start_time = std::chrono::steady_clock::now();
+		const int failed_maps = generate_parallel(tile_set, sample_model, options);
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		const double cells = static_cast<double>(options.width) * options.height * options.count;
+		std::cerr << "Generated " << options.count - failed_maps << "/" << options.count << " maps in " << seconds << "s, each on " << options.threads << " threads ("
+				  << cells / seconds << " cells/s)" << std::endl;
+
+		return failed_maps == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	BatchGenerator batch_generator(tile_set, options.threads);
+	BatchGenerator::Settings settings;
+	settings.width = options.width;
+	settings.height = options.height;
+	settings.count = options.count;
+	settings.base_seed = options.seed;
+	settings.max_attempts = options.max_attempts;
+	settings.propagator = options.propagator;
+	settings.backtracking.is_enabled = options.is_backtracking_enabled;
+	settings.stats_mode = options.stats_mode;
+	settings.is_specialized = options.is_specialized;
+	settings.grid_type = options.grid_type;
+	settings.depth = options.grid_type == TileMapSolver::GridType::Voxel ? options.depth : 1;
+
+	std::atomic<int> failed_maps = 0;
+	std::mutex log_mutex;
+	const auto start_time = std::chrono::steady_clock::now();
+
+	batch_generator.generate(settings, [&](BatchGenerator::MapResult&& map)
+	{
+		const string map_prefix = options.output_prefix + "_" + std::to_string(map.map_idx);
+		if (map.stats.is_enabled())
+		{
+			std::ofstream stats_file(map_prefix + ".stats.json");
+			map.stats.write_summary_json(stats_file);
+			stats_file << "\n";
+		}
+		if (map.stats.get_mode() == GenerationStats::Mode::Trace)
+		{
+			std::ofstream trace_file(map_prefix + ".trace.json");
+			map.stats.write_chrome_trace(trace_file);
+		}
+
+		if (map.result.status != TileMapGenerator::GenerationStatus::Finished)
+		{
+			std::lock_guard lock(log_mutex);
+			std::cerr << "Map " << map.map_idx << ": contradiction in all " << map.attempts << " attempts" << std::endl;
+			failed_maps++;
+			return;
+		}
+
+		const string path = map_prefix + TileMapWriter::get_extension(options.format);
+		// voxel layers are stacked vertically
+		if (!TileMapWriter::write(path, options.format, options.width, options.height * settings.depth, tile_set.get_tile_count(), map.tile_ids))
+		{
+			failed_maps++;
+		}
+		write_render(sample_model, map_prefix, map.tile_ids, options);
+	});
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	const double cells = static_cast<double>(options.width) * options.height * settings.depth * options.count;
+	std::cerr << "Generated " << options.count - failed_maps << "/" << options.count << " maps in " << seconds << "s on " << batch_generator.get_thread_count() << " threads ("
+			  << cells / seconds << " cells/s)" << std::endl;
+
+	return failed_maps == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}